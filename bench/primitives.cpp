@@ -0,0 +1,362 @@
+// Microbenchmarks of the common.hpp primitives.
+//
+//   make bench                      # runs bench/primitives bench/results.json
+//   bench/primitives [RESULTS]
+//
+// Every case is timed for at least MIN_TIME and reported as ns/byte,
+// allocations per call and, where hardware counters are permitted, cache
+// misses per byte. Results already in RESULTS are read first and
+// each case is shown with its change against them; the file is then
+// overwritten with the new numbers, one JSON object per line.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "simd.hpp"
+
+namespace {
+
+constexpr std::chrono::milliseconds MIN_TIME{200};
+
+struct Result {
+    std::string name;
+    size_t bytes{0};
+    double ns_per_byte{0};
+    double allocs_per_call{0};
+    std::optional<double> misses_per_byte;
+};
+
+// Keep the compiler from discarding a result
+template <typename T>
+auto keep(const T& value) -> void
+{
+    asm volatile("" : : "r,m"(value) : "memory"); // NOLINT(hicpp-no-assembler)
+}
+
+auto measure(const std::string& name, size_t bytes, const std::function<void()>& call) -> Result
+{
+    PerfCounters counters(true);
+    call(); // Warm up
+    const AllocStats before = alloc_stats();
+    counters.start();
+    const auto start = std::chrono::steady_clock::now();
+    size_t calls = 0;
+    std::chrono::nanoseconds elapsed{0};
+    while (elapsed < MIN_TIME) {
+	call();
+	calls++;
+	elapsed = std::chrono::steady_clock::now() - start;
+    }
+    counters.stop();
+    const AllocStats after = alloc_stats();
+
+    const auto total_bytes = static_cast<double>(calls * std::max<size_t>(bytes, 1));
+    const std::optional<uint64_t> misses = counters.count("cache_misses");
+    return {
+	.name = name,
+	.bytes = bytes,
+	.ns_per_byte = static_cast<double>(elapsed.count()) / total_bytes,
+	.allocs_per_call = static_cast<double>(after.count - before.count) / static_cast<double>(calls),
+	.misses_per_byte = misses ? std::optional<double>(static_cast<double>(*misses) / total_bytes) : std::nullopt,
+    };
+}
+
+// size bytes of lines of line_length characters, fields of field_length
+// characters separated by commas
+auto make_text(size_t size, size_t line_length, size_t field_length) -> std::string
+{
+    std::string text;
+    text.reserve(size);
+    size_t column = 0;
+    while (text.size() < size) {
+	if (column == line_length) {
+	    text += '\n';
+	    column = 0;
+	} else if (column % (field_length + 1) == field_length) {
+	    text += ',';
+	    column++;
+	} else {
+	    text += static_cast<char>('0' + (text.size() % 10)); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    column++;
+	}
+    }
+    text += '\n';
+    return text;
+}
+
+auto make_grid_text(size_t nrows, size_t ncols) -> std::string
+{
+    std::string text;
+    text.reserve(nrows * (ncols + 1));
+    for (size_t i = 0; i < nrows; i++) {
+	for (size_t j = 0; j < ncols; j++) {
+	    text += ((i * 7) + j) % 3 == 0 ? '@' : '.'; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	}
+	text += '\n';
+    }
+    return text;
+}
+
+// Eight-neighbour counts over every cell, as in day 4, visiting cells row
+// by row or column by column. The row-major layout only suits the first.
+template <typename Layout>
+auto stencil_cases(const std::string& layout, std::vector<Result>& results) -> void
+{
+    const std::vector<std::pair<size_t, size_t>> shapes = {{1024, 1024}, {4096, 4096}, {64, 65536}};
+    for (const auto& [nrows, ncols] : shapes) {
+	const std::string text = make_grid_text(nrows, ncols);
+	const Grid<char, Layout> grid(text, [](auto, auto, char chr) -> char { return chr; });
+	const auto neighbours = [&](size_t i, size_t j) -> size_t {
+	    size_t count = 0;
+	    for (size_t ni = std::max<size_t>(i, 1) - 1; ni <= std::min(i + 1, nrows - 1); ni++) {
+		for (size_t nj = std::max<size_t>(j, 1) - 1; nj <= std::min(j + 1, ncols - 1); nj++) {
+		    count += grid.m_buf[grid.m_layout.index(ni, nj)] == '@' ? 1 : 0;
+		}
+	    }
+	    return count;
+	};
+
+	const std::string suffix = "/" + layout + "/" + std::to_string(nrows) + "x" + std::to_string(ncols);
+	results.push_back(measure("stencil_rows" + suffix, nrows * ncols, [&]() -> void {
+	    size_t count = 0;
+	    for (size_t i = 0; i < nrows; i++) {
+		for (size_t j = 0; j < ncols; j++) {
+		    count += neighbours(i, j) < 4 ? 1 : 0; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		}
+	    }
+	    keep(count);
+	}));
+	results.push_back(measure("stencil_cols" + suffix, nrows * ncols, [&]() -> void {
+	    size_t count = 0;
+	    for (size_t j = 0; j < ncols; j++) {
+		for (size_t i = 0; i < nrows; i++) {
+		    count += neighbours(i, j) < 4 ? 1 : 0; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		}
+	    }
+	    keep(count);
+	}));
+    }
+}
+
+// The dispatched kernels, once per variant this CPU runs
+auto isa_cases(std::vector<Result>& results) -> void
+{
+    const std::string lines = make_text(1 << 22, 8, 8); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    std::vector<std::string> numbers;
+    size_t number_bytes = 0;
+    for (size_t i = 0; i < 4096; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	numbers.push_back(std::to_string(i * 2654435761ULL)); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	number_bytes += numbers.back().size();
+    }
+    const std::string grid_text = make_grid_text(1000, 1000); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    const GridView<const char> grid = text_grid(grid_text);
+    std::vector<uint8_t> counts(grid.ncols);
+    const auto line = [&](size_t i) -> std::string_view {
+	return i < grid.nrows ? std::string_view(grid.row(i).data(), grid.ncols) : std::string_view();
+    };
+
+    std::vector<size_t> starts;
+    std::vector<size_t> ends;
+    for (size_t k = 0; k < 1000; k++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	starts.push_back(k * 1000); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	ends.push_back((k * 1000) + 400); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    std::vector<size_t> ids;
+    for (size_t i = 0; i < 1 << 16; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	ids.push_back((i * 2654435761ULL) % 1000000); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    for (const Isa variant : ISAS) {
+	if (!isa_supported(variant)) {
+	    continue;
+	}
+	const ScopedIsa forced(variant);
+	const std::string suffix = "/" + std::string(isa_name(variant));
+	results.push_back(measure("for_each_line" + suffix, lines.size(), [&]() -> void {
+	    size_t count = 0;
+	    for_each_line(lines, [&](std::string_view) -> void { count++; });
+	    keep(count);
+	}));
+	results.push_back(measure("parse_integer" + suffix, number_bytes, [&]() -> void {
+	    Answer sum = 0;
+	    for (const std::string& number : numbers) {
+		sum += parse_integer(number);
+	    }
+	    keep(sum);
+	}));
+	results.push_back(measure("count_neighbours" + suffix, grid.nrows * grid.ncols, [&]() -> void {
+	    for (size_t i = 0; i < grid.nrows; i++) {
+		count_neighbours(i > 0 ? line(i - 1) : std::string_view(), line(i), line(i + 1), '@', counts);
+	    }
+	    keep(counts.front());
+	}));
+	results.push_back(measure("count_in_ranges" + suffix, ids.size() * sizeof(size_t), [&]() -> void {
+	    keep(count_in_ranges(starts, ends, ids));
+	}));
+    }
+}
+
+auto run_cases() -> std::vector<Result>
+{
+    std::vector<Result> results;
+    const std::vector<size_t> sizes = {1 << 10, 1 << 16, 1 << 22};
+    const std::vector<size_t> line_lengths = {8, 80, 1000};
+    const std::vector<size_t> field_lengths = {1, 16, 256};
+
+    for (const size_t size : sizes) {
+	for (const size_t line_length : line_lengths) {
+	    const std::string text = make_text(size, line_length, line_length);
+	    const std::string suffix = "/" + std::to_string(size) + "B/line" + std::to_string(line_length);
+	    results.push_back(measure("split_lines" + suffix, text.size(), [&]() -> void {
+		keep(split_lines(text));
+	    }));
+	    results.push_back(measure("split_at_string" + suffix, text.size(), [&]() -> void {
+		keep(split_at(text, '\n'));
+	    }));
+	    results.push_back(measure("split_at_stream" + suffix, text.size(), [&]() -> void {
+		std::istringstream stream(text);
+		keep(split_at(stream, '\n'));
+	    }));
+	}
+	for (const size_t field_length : field_lengths) {
+	    const std::string text = make_text(size, size, field_length);
+	    results.push_back(measure("split_at_comma/" + std::to_string(size) + "B/field"
+				      + std::to_string(field_length), text.size(), [&]() -> void {
+		keep(split_at(text, ','));
+	    }));
+	}
+    }
+
+    const std::vector<std::pair<size_t, size_t>> shapes = {{32, 32}, {141, 141}, {1000, 1000}, {100, 10000}};
+    for (const auto& [nrows, ncols] : shapes) {
+	const std::string text = make_grid_text(nrows, ncols);
+	const std::string suffix = "/" + std::to_string(nrows) + "x" + std::to_string(ncols);
+	results.push_back(measure("grid_construct" + suffix, text.size(), [&]() -> void {
+	    keep(Grid<char>(text, [](auto, auto, char chr) -> char { return chr; }));
+	}));
+
+	Grid<char> grid(text, [](auto, auto, char chr) -> char { return chr; });
+	results.push_back(measure("grid_at" + suffix, nrows * ncols, [&]() -> void {
+	    size_t count = 0;
+	    for (size_t i = 0; i < grid.nrows; i++) {
+		for (size_t j = 0; j < grid.ncols; j++) {
+		    count += grid.at(i, j) == '@' ? 1 : 0;
+		}
+	    }
+	    keep(count);
+	}));
+	results.push_back(measure("grid_ref" + suffix, nrows * ncols, [&]() -> void {
+	    for (size_t i = 0; i < grid.nrows; i++) {
+		for (size_t j = 0; j < grid.ncols; j++) {
+		    grid.ref(i, j) ^= 1;
+		}
+	    }
+	    keep(grid.m_buf.front());
+	}));
+    }
+
+    stencil_cases<RowMajor>("row_major", results);
+    stencil_cases<Tiled<>>("tiled64", results);
+    stencil_cases<Morton>("morton", results);
+
+    isa_cases(results);
+
+    return results;
+}
+
+auto to_json(const Result& result) -> std::string
+{
+    std::stringstream line;
+    line << R"({"name": ")" << result.name
+	 << R"(", "bytes": )" << result.bytes
+	 << R"(, "ns_per_byte": )" << result.ns_per_byte
+	 << R"(, "allocs_per_call": )" << result.allocs_per_call
+	 << R"(, "cache_misses_per_byte": )";
+    if (result.misses_per_byte) {
+	line << *result.misses_per_byte;
+    } else {
+	line << "null";
+    }
+    line << "}";
+    return line.str();
+}
+
+// Only what this program writes needs to be understood
+auto load_baseline(const std::string& path) -> std::map<std::string, double>
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+	const size_t name = line.find(R"("name": ")");
+	const size_t speed = line.find(R"("ns_per_byte": )");
+	if (name == std::string::npos || speed == std::string::npos) {
+	    continue;
+	}
+	const size_t name_start = name + std::string(R"("name": ")").size();
+	baseline[line.substr(name_start, line.find('"', name_start) - name_start)]
+	    = std::stod(line.substr(speed + std::string(R"("ns_per_byte": )").size()));
+    }
+    return baseline;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) // NOLINT
+{
+    try {
+	const std::span<char *> args(argv, argc);
+	const std::string path = args.size() > 1 ? args[1] : "bench/results.json";
+	const std::map<std::string, double> baseline = load_baseline(path);
+
+	const std::vector<Result> results = run_cases();
+
+	std::cout << std::left << std::setw(40) << "case" << std::right // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << std::setw(12) << "ns/byte" << std::setw(14) << "allocs/call" << std::setw(14) << "misses/byte" // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << std::setw(10) << "change" << '\n'; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	for (const Result& result : results) {
+	    std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		      << std::setprecision(3) << std::setw(12) << result.ns_per_byte
+		      << std::setprecision(1) << std::setw(14) << result.allocs_per_call // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		      << std::setprecision(4) << std::setw(14); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    if (result.misses_per_byte) {
+		std::cout << *result.misses_per_byte;
+	    } else {
+		std::cout << "-";
+	    }
+	    const auto previous = baseline.find(result.name);
+	    if (previous != baseline.end() && previous->second > 0) {
+		std::cout << std::showpos << std::setw(9) << 100 * ((result.ns_per_byte / previous->second) - 1) << '%' << std::noshowpos; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    }
+	    std::cout << '\n';
+	}
+
+	std::ofstream out(path);
+	for (const Result& result : results) {
+	    out << to_json(result) << '\n';
+	}
+	if (!out) {
+	    throw std::runtime_error("Unable to write " + path);
+	}
+    } catch (const std::exception& e) {
+	std::cerr << "FATAL: Uncaught exception: " << e.what() << '\n';
+	return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
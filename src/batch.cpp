@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "common.hpp"
+
+namespace {
+
+struct BatchResult {
+    size_t bytes{0};
+    std::optional<Answer> part_1;
+    std::optional<Answer> part_2;
+    std::string error;
+    bool ready{false};
+};
+
+// Read a file into a buffer that is reused from one input to the next
+auto read_into(const std::string& path, std::string& buffer) -> void
+{
+    std::ifstream ifile(path, std::ios::binary | std::ios::ate);
+    if (!ifile) {
+	throw std::runtime_error("Unable to open " + path);
+    }
+    const std::streamsize size = ifile.tellg();
+    ifile.seekg(0);
+    buffer.resize(static_cast<size_t>(size));
+    ifile.read(buffer.data(), size);
+}
+
+auto solve(const Solver& solver, const std::string& input) -> std::optional<Answer>
+{
+    try {
+	return solver(input);
+    } catch (NotImplemented&) {
+	return {};
+    }
+}
+
+// Control characters are not allowed raw in a JSON string
+auto json_escape(const std::string& str) -> std::string
+{
+    constexpr std::string_view HEX = "0123456789abcdef";
+    constexpr unsigned char FIRST_PRINTABLE = 0x20;
+    std::string escaped;
+    for (const char chr : str) {
+	switch (chr) {
+	case '"':
+	    escaped += "\\\"";
+	    break;
+	case '\\':
+	    escaped += "\\\\";
+	    break;
+	case '\n':
+	    escaped += "\\n";
+	    break;
+	case '\r':
+	    escaped += "\\r";
+	    break;
+	case '\t':
+	    escaped += "\\t";
+	    break;
+	default:
+	    if (static_cast<unsigned char>(chr) < FIRST_PRINTABLE) {
+		escaped += "\\u00";
+		escaped += HEX[static_cast<unsigned char>(chr) >> 4]; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		escaped += HEX[static_cast<unsigned char>(chr) & 0xF]; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    } else {
+		escaped += chr;
+	    }
+	}
+    }
+    return escaped;
+}
+
+auto format_answer(const std::optional<Answer>& answer, const char *none) -> std::string
+{
+    return answer ? std::to_string(*answer) : none;
+}
+
+auto format_result(int day, const std::string& path, const BatchResult& result, bool jsonl) -> std::string
+{
+    std::stringstream line;
+    if (jsonl) {
+	line << R"({"day": )" << day
+	     << R"(, "input": ")" << json_escape(path)
+	     << R"(", "bytes": )" << result.bytes
+	     << R"(, "part_1": )" << format_answer(result.part_1, "null")
+	     << R"(, "part_2": )" << format_answer(result.part_2, "null");
+	if (!result.error.empty()) {
+	    line << R"(, "error": ")" << json_escape(result.error) << '"';
+	}
+	line << "}";
+    } else {
+	line << path << " " << format_answer(result.part_1, "-")
+	     << " " << format_answer(result.part_2, "-");
+	if (!result.error.empty()) {
+	    line << " ERROR: " << result.error;
+	}
+    }
+    return line.str();
+}
+
+} // namespace
+
+auto list_inputs(const std::string& path) -> std::vector<std::string>
+{
+    std::vector<std::string> inputs;
+    if (std::filesystem::is_directory(path)) {
+	for (const auto& entry : std::filesystem::directory_iterator(path)) {
+	    if (entry.is_regular_file()) {
+		inputs.push_back(entry.path().string());
+	    }
+	}
+	std::ranges::sort(inputs);
+	return inputs;
+    }
+
+    std::ifstream manifest(path);
+    if (!manifest) {
+	throw std::runtime_error("Unable to open " + path);
+    }
+    return split_at(manifest, '\n');
+}
+
+// Workers claim inputs in order, but never run further ahead than the
+// window past the last result written, so memory stays bounded while
+// results are still emitted in input order. Each worker keeps its read
+// buffer and a scratch arena for the solvers from one input to the next,
+// so that after the first few inputs they rarely allocate.
+auto run_batch(int day, const Solver& part_1, const Solver& part_2, const BatchOptions& options) -> int
+{
+    const size_t n_inputs = options.inputs.size();
+    const size_t jobs = options.jobs != 0 ? options.jobs
+	: std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t window = options.window != 0 ? options.window : 4 * jobs;
+
+    std::vector<BatchResult> results(n_inputs);
+    std::mutex mutex;
+    std::condition_variable claimable;
+    std::condition_variable completed;
+    size_t next_input = 0;
+    size_t written = 0;
+
+    const auto worker = [&]() -> void {
+	std::string buffer;
+	ScratchArena arena;
+	const ScopedScratch scratch(arena);
+	while (true) {
+	    size_t idx = 0;
+	    {
+		std::unique_lock<std::mutex> lock(mutex);
+		claimable.wait(lock, [&]() -> bool {
+		    return next_input >= n_inputs || next_input < written + window;
+		});
+		if (next_input >= n_inputs) {
+		    return;
+		}
+		idx = next_input++;
+	    }
+
+	    BatchResult result;
+	    try {
+		read_into(options.inputs[idx], buffer);
+		result.bytes = buffer.size();
+		if (!options.part || *options.part == 1) {
+		    result.part_1 = solve(part_1, buffer);
+		}
+		if (!options.part || *options.part == 2) {
+		    result.part_2 = solve(part_2, buffer);
+		}
+	    } catch (const std::exception& e) {
+		result.error = e.what();
+	    }
+	    result.ready = true;
+	    arena.rewind();
+
+	    {
+		const std::scoped_lock<std::mutex> lock(mutex);
+		results[idx] = std::move(result);
+	    }
+	    completed.notify_one();
+	}
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::jthread> pool;
+    pool.reserve(jobs);
+    for (size_t i = 0; i < jobs; i++) {
+	pool.emplace_back(worker);
+    }
+
+    size_t total_bytes = 0;
+    size_t n_errors = 0;
+    for (size_t idx = 0; idx < n_inputs; idx++) {
+	BatchResult result;
+	{
+	    std::unique_lock<std::mutex> lock(mutex);
+	    completed.wait(lock, [&]() -> bool { return results[idx].ready; });
+	    result = std::move(results[idx]);
+	    results[idx] = BatchResult{};
+	    written = idx + 1;
+	}
+	claimable.notify_all();
+
+	total_bytes += result.bytes;
+	n_errors += result.error.empty() ? 0 : 1;
+	std::cout << format_result(day, options.inputs[idx], result, options.jsonl) << '\n';
+    }
+    pool.clear();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double seconds = std::max(elapsed.count(), 1e-9); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    std::cerr << "Day " << day << ", Batch  // " << n_inputs << " inputs, "
+	      << total_bytes << " bytes in " << seconds << " s: "
+	      << static_cast<double>(n_inputs) / seconds << " inputs/s, "
+	      << static_cast<double>(total_bytes) / seconds << " bytes/s" << '\n';
+
+    return n_errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
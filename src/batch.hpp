@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+struct BatchOptions {
+    std::vector<std::string> inputs;
+    std::optional<int> part;
+    bool jsonl{false};
+    size_t jobs{0}; // 0: one per hardware thread
+    size_t window{0}; // Max. inputs in flight; 0: four per job
+};
+
+using Solver = std::function<Answer(const std::string&)>;
+
+// Files of a directory, or the paths listed in a manifest file
+std::vector<std::string> list_inputs(const std::string& path);
+
+int run_batch(int day, const Solver& part_1, const Solver& part_2, const BatchOptions& options);
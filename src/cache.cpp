@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.hpp"
+
+namespace {
+
+// xxHash64
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+constexpr size_t STRIPE = 32;
+
+auto read_u64(const char *ptr) -> uint64_t
+{
+    uint64_t word = 0;
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+auto read_u32(const char *ptr) -> uint32_t
+{
+    uint32_t word = 0;
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+auto xxh_round(uint64_t acc, uint64_t input) -> uint64_t
+{
+    return std::rotl(acc + (input * PRIME_2), 31) * PRIME_1; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+}
+
+auto merge_round(uint64_t acc, uint64_t val) -> uint64_t
+{
+    return ((acc ^ xxh_round(0, val)) * PRIME_1) + PRIME_4;
+}
+
+auto cache_dir() -> std::filesystem::path
+{
+    const char *env = std::getenv("AOC2025_CACHE"); // NOLINT(concurrency-mt-unsafe)
+    return (env != nullptr) ? env : ".cache";
+}
+
+// Read-only mapping of a whole file, unmapped with the last reference.
+// Empty files give no mapping.
+auto map_file(const std::string& path) -> std::pair<std::shared_ptr<const void>, size_t>
+{
+    const int fd = ::open(path.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+    if (fd < 0) {
+	throw std::runtime_error("Unable to open " + path);
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0) {
+	::close(fd);
+	throw std::runtime_error("Unable to stat " + path);
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+	::close(fd);
+	return {nullptr, 0};
+    }
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast,performance-no-int-to-ptr)
+	throw std::runtime_error("Unable to map " + path);
+    }
+    return {std::shared_ptr<const void>(map, [size](const void *ptr) -> void { ::munmap(const_cast<void *>(ptr), size); }), size}; // NOLINT(cppcoreguidelines-pro-type-const-cast)
+}
+
+// Write through a temporary file then rename, so that concurrent runs
+// never see a partial entry. Every writer has its own temporary file,
+// threads of one process included. Entries of the same day and part left by
+// other solver versions are removed first.
+auto replace_entry(const std::string& name, const std::string& day_part, std::string_view contents) -> void
+{
+    const std::filesystem::path dir = cache_dir();
+    std::error_code err;
+    std::filesystem::create_directories(dir, err);
+    if (err) {
+	return;
+    }
+
+    const std::string version = name.substr(0, day_part.size() + 16); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    for (const auto& entry : std::filesystem::directory_iterator(dir, err)) {
+	const std::string other = entry.path().filename().string();
+	if (other.starts_with(day_part) && !other.starts_with(version)) {
+	    std::filesystem::remove(entry.path(), err);
+	}
+    }
+
+    static std::atomic<uint64_t> n_written{0};
+    const std::filesystem::path tmp = dir / (name + ".tmp" + std::to_string(::getpid()) + "-" + std::to_string(n_written++));
+    {
+	std::ofstream out(tmp, std::ios::binary);
+	out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+	if (!out) {
+	    out.close();
+	    std::filesystem::remove(tmp, err);
+	    return;
+	}
+    }
+    std::filesystem::rename(tmp, dir / name, err);
+    if (err) {
+	std::filesystem::remove(tmp, err);
+    }
+}
+
+constexpr uint64_t MODEL_MAGIC = 0x4c444f4d434f41; // "AOCMODL"
+constexpr size_t MODEL_HEADER_WORDS = 8;
+constexpr size_t MODEL_PAYLOAD_HASH = 6; // Header word hashing everything after the header
+constexpr size_t MODEL_N_ARRAYS = 7;
+
+auto pad_to_word(size_t size) -> size_t
+{
+    return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+}
+
+} // namespace
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+auto hash_bytes(std::string_view data) -> uint64_t
+{
+    const char *ptr = data.data();
+    const char *const end = ptr + data.size();
+    uint64_t hash = 0;
+
+    if (data.size() >= STRIPE) {
+	std::array<uint64_t, 4> lanes = {PRIME_1 + PRIME_2, PRIME_2, 0, 0 - PRIME_1};
+	for (; ptr + STRIPE <= end; ptr += STRIPE) {
+	    for (size_t lane = 0; lane < lanes.size(); lane++) {
+		lanes.at(lane) = xxh_round(lanes.at(lane), read_u64(ptr + (lane * sizeof(uint64_t))));
+	    }
+	}
+	hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+	for (const uint64_t lane : lanes) {
+	    hash = merge_round(hash, lane);
+	}
+    } else {
+	hash = PRIME_5;
+    }
+
+    hash += data.size();
+    for (; ptr + sizeof(uint64_t) <= end; ptr += sizeof(uint64_t)) {
+	hash = (std::rotl(hash ^ xxh_round(0, read_u64(ptr)), 27) * PRIME_1) + PRIME_4;
+    }
+    if (ptr + sizeof(uint32_t) <= end) {
+	hash = (std::rotl(hash ^ (read_u32(ptr) * PRIME_1), 23) * PRIME_2) + PRIME_3;
+	ptr += sizeof(uint32_t);
+    }
+    for (; ptr < end; ptr++) {
+	hash = std::rotl(hash ^ (static_cast<uint8_t>(*ptr) * PRIME_5), 11) * PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+// Hash a file through a read-only mapping, without copying it
+auto hash_file(const std::string& path) -> uint64_t
+{
+    const auto [map, size] = map_file(path);
+    return hash_bytes({static_cast<const char *>(map.get()), size});
+}
+
+// dayN-P-<version hash>-<input hash>
+auto entry_name(const CacheKey& key, bool with_input) -> std::string
+{
+    std::stringstream name;
+    name << "day" << key.day << "-" << key.part << "-";
+    if (with_input) {
+	name << std::hex << std::setfill('0') << std::setw(16) << hash_bytes(key.version)
+	     << "-" << std::setw(16) << key.input;
+    }
+    return name.str();
+}
+
+// An answer, followed by " ?" when no answer file checked it
+auto cache_lookup(const CacheKey& key) -> std::optional<CachedAnswer>
+{
+    std::ifstream entry(cache_dir() / entry_name(key, true));
+    Answer answer = 0;
+    if (!(entry >> answer)) {
+	return {};
+    }
+    std::string mark;
+    entry >> mark;
+    if (!mark.empty() && mark != "?") {
+	return {};
+    }
+    return CachedAnswer{answer, mark.empty()};
+}
+
+auto cache_store(const CacheKey& key, Answer answer, bool verified) -> void
+{
+    replace_entry(entry_name(key, true), entry_name(key, false), std::to_string(answer) + (verified ? "\n" : " ?\n"));
+}
+
+auto ModelWriter::encode(const CacheKey& key) const -> std::string
+{
+    std::vector<uint64_t> header = {
+	MODEL_MAGIC, MODEL_FORMAT, static_cast<uint64_t>(key.day), static_cast<uint64_t>(key.part),
+	hash_bytes(key.version), key.input, 0, m_arrays.size(),
+    };
+    for (const std::string& array : m_arrays) {
+	header.push_back(array.size());
+    }
+
+    std::string bytes(reinterpret_cast<const char *>(header.data()), header.size() * sizeof(uint64_t)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    for (const std::string& array : m_arrays) {
+	bytes += array;
+	bytes.resize(pad_to_word(bytes.size()), '\0');
+    }
+    const uint64_t payload_hash = hash_bytes(std::string_view(bytes).substr(MODEL_HEADER_WORDS * sizeof(uint64_t)));
+    std::memcpy(&bytes[MODEL_PAYLOAD_HASH * sizeof(uint64_t)], &payload_hash, sizeof(payload_hash));
+    return bytes;
+}
+
+auto ModelSnapshot::decode(std::shared_ptr<const void> storage, std::span<const std::byte> bytes,
+			   const CacheKey& key) -> std::optional<ModelSnapshot>
+{
+    const size_t n_words = bytes.size() / sizeof(uint64_t);
+    const auto word = [&](size_t idx) -> uint64_t {
+	return read_u64(reinterpret_cast<const char *>(bytes.data()) + (idx * sizeof(uint64_t))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    };
+    if (n_words < MODEL_HEADER_WORDS
+	|| word(0) != MODEL_MAGIC || word(1) != MODEL_FORMAT
+	|| word(2) != static_cast<uint64_t>(key.day) || word(3) != static_cast<uint64_t>(key.part)
+	|| word(4) != hash_bytes(key.version) || word(5) != key.input
+	|| word(MODEL_N_ARRAYS) > n_words - MODEL_HEADER_WORDS) {
+	return {};
+    }
+    // Lengths alone would let a damaged entry through
+    const std::string_view contents(reinterpret_cast<const char *>(bytes.data()), bytes.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (word(MODEL_PAYLOAD_HASH) != hash_bytes(contents.substr(MODEL_HEADER_WORDS * sizeof(uint64_t)))) {
+	return {};
+    }
+
+    ModelSnapshot snapshot;
+    snapshot.m_storage = std::move(storage);
+    const size_t n_arrays = word(MODEL_N_ARRAYS);
+    size_t offset = (MODEL_HEADER_WORDS + n_arrays) * sizeof(uint64_t);
+    for (size_t i = 0; i < n_arrays; i++) {
+	const uint64_t size = word(MODEL_HEADER_WORDS + i);
+	if (size > bytes.size() - offset) {
+	    return {};
+	}
+	snapshot.m_arrays.push_back(bytes.subspan(offset, size));
+	offset = std::min(pad_to_word(offset + size), bytes.size());
+    }
+    return snapshot;
+}
+
+ScratchDir::ScratchDir(bool as_cache)
+    : m_as_cache{as_cache}
+{
+    static std::atomic<uint64_t> n_created{0};
+    m_path = std::filesystem::temp_directory_path()
+	/ ("aoc2025-" + std::to_string(::getpid()) + "-" + std::to_string(n_created++));
+    std::filesystem::remove_all(m_path);
+    std::filesystem::create_directories(m_path);
+    if (m_as_cache) {
+	if (const char *previous = std::getenv("AOC2025_CACHE")) { // NOLINT(concurrency-mt-unsafe)
+	    m_previous_cache = previous;
+	}
+	::setenv("AOC2025_CACHE", m_path.c_str(), 1); // NOLINT(concurrency-mt-unsafe)
+    }
+}
+
+ScratchDir::~ScratchDir()
+{
+    if (m_as_cache) {
+	if (m_previous_cache) {
+	    ::setenv("AOC2025_CACHE", m_previous_cache->c_str(), 1); // NOLINT(concurrency-mt-unsafe)
+	} else {
+	    ::unsetenv("AOC2025_CACHE"); // NOLINT(concurrency-mt-unsafe)
+	}
+    }
+    std::error_code err;
+    std::filesystem::remove_all(m_path, err);
+}
+
+auto model_lookup(const CacheKey& key) -> std::optional<ModelSnapshot>
+{
+    const std::filesystem::path path = cache_dir() / ("model-" + entry_name(key, true));
+    std::error_code err;
+    if (!std::filesystem::is_regular_file(path, err)) {
+	return {};
+    }
+    try {
+	auto [map, size] = map_file(path.string());
+	const std::span<const std::byte> bytes(static_cast<const std::byte *>(map.get()), size);
+	return ModelSnapshot::decode(std::move(map), bytes, key);
+    } catch (std::runtime_error&) {
+	return {};
+    }
+}
+
+auto model_store(const CacheKey& key, const ModelWriter& model) -> void
+{
+    replace_entry("model-" + entry_name(key, true), "model-" + entry_name(key, false), model.encode(key));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// Day entry points behind the subcommands of main.cpp, beyond those every
+// day has through DAY(N). The days include this header too, so that their
+// definitions are checked against it.
+
+// Days with a streaming solver
+namespace day1 {
+std::unique_ptr<StreamSolver> stream_solver(int part);
+}
+namespace day3 {
+std::unique_ptr<StreamSolver> stream_solver(int part);
+}
+namespace day5 {
+std::unique_ptr<StreamSolver> stream_solver(int part);
+}
+
+// Worksheets too wide to hold, read column by column from one stream per
+// row of the file at path
+namespace day6 {
+Answer stream_evaluate_file(const std::string& path, bool column_wise);
+}
+
+// Timelines of day 7 for the source in every column of its row, day 7
+// part 1 or 2 on a coordinate list of splitters, and both parts again
+// after each splitter edit read from edits
+namespace day7 {
+std::vector<Answer> all_source_timelines(const std::string& input);
+Answer sparse_sweep_file(const std::string& path, int part);
+void edit_manifold(const std::string& input, std::istream& edits, std::ostream& answers);
+}
@@ -1,7 +1,15 @@
 #include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <istream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -35,3 +43,101 @@ auto split_lines(const std::string& str) -> std::vector<std::string>
     return split_at(str, '\n');
 }
 
+
+
+auto solve_stream(std::istream& stream, StreamSolver& solver, size_t chunk_size) -> Answer
+{
+    std::vector<char> buffer(chunk_size);
+    while (stream) {
+	stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	solver.consume(std::string_view(buffer.data(), static_cast<size_t>(stream.gcount())));
+    }
+    return solver.finish();
+}
+
+namespace {
+
+// Blocks start at this size and at least double
+constexpr size_t SCRATCH_BLOCK = size_t{64} * 1024;
+
+thread_local std::pmr::memory_resource *thread_scratch = nullptr;
+
+} // namespace
+
+auto ScratchArena::rewind() -> void
+{
+    const std::scoped_lock lock(m_mutex);
+    if (m_blocks.size() > 1) {
+	m_blocks.clear();
+	m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(m_capacity)); // NOLINT(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+	m_block_size = m_capacity;
+    }
+    m_used = 0;
+}
+
+auto ScratchArena::capacity() const -> size_t
+{
+    const std::scoped_lock lock(m_mutex);
+    return m_capacity;
+}
+
+auto ScratchArena::do_allocate(size_t bytes, size_t alignment) -> void *
+{
+    const std::scoped_lock lock(m_mutex);
+    if (!m_blocks.empty()) {
+	void *ptr = std::next(m_blocks.back().get(), static_cast<std::ptrdiff_t>(m_used));
+	size_t space = m_block_size - m_used;
+	if (std::align(alignment, bytes, ptr, space) != nullptr) {
+	    m_used = m_block_size - space + bytes;
+	    return ptr;
+	}
+    }
+    // Blocks are aligned for any fundamental type: only larger alignments
+    // may need padding
+    const size_t size = std::max({SCRATCH_BLOCK, 2 * m_block_size, bytes + alignment});
+    m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(size)); // NOLINT(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+    m_block_size = size;
+    m_capacity += size;
+    void *ptr = m_blocks.back().get();
+    size_t space = size;
+    std::align(alignment, bytes, ptr, space);
+    m_used = size - space + bytes;
+    return ptr;
+}
+
+auto ScratchArena::do_deallocate(void *ptr, size_t bytes, size_t alignment) -> void
+{
+    UNUSED(ptr);
+    UNUSED(bytes);
+    UNUSED(alignment);
+}
+
+auto ScratchArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool
+{
+    return this == &other;
+}
+
+auto scratch_memory() -> std::pmr::memory_resource *
+{
+    return thread_scratch != nullptr ? thread_scratch : std::pmr::get_default_resource();
+}
+
+ScopedScratch::ScopedScratch(ScratchArena& arena)
+    : m_previous{thread_scratch}
+{
+    thread_scratch = &arena;
+}
+
+ScopedScratch::~ScopedScratch()
+{
+    thread_scratch = m_previous;
+}
+
+auto run_bands(size_t n, size_t jobs, const std::function<void(size_t, size_t)>& band) -> void
+{
+    std::vector<std::jthread> threads;
+    threads.reserve(jobs);
+    for (size_t job = 0; job < jobs; job++) {
+	threads.emplace_back(band, n * job / jobs, n * (job + 1) / jobs);
+    }
+}
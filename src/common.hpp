@@ -1,18 +1,83 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#include "parallel.hpp"
+#include "simd.hpp"
+
 using Answer = int64_t;
 
+// Identifies the sources a translation unit was built from; the Makefile
+// sets it to a hash of the day's source, its headers and the shared
+// sources.
+#ifndef SOURCE_HASH
+#define SOURCE_HASH __DATE__ " " __TIME__
+#endif
+
 std::vector<std::string> split_at(std::istream& stream, char delim, bool allow_empty = false);
 std::vector<std::string> split_at(const std::string& str, char delim, bool allow_empty = false);
 
 std::vector<std::string> split_lines(const std::string& str);
 
+// Persistent answer cache, keyed by day, part, solver version and a hash
+// of the input content. The directory is $AOC2025_CACHE, or .cache.
+struct CacheKey {
+    int day;
+    int part;
+    std::string_view version;
+    uint64_t input;
+};
+
+// Verified answers matched an answer file when they were stored
+struct CachedAnswer {
+    Answer answer;
+    bool verified;
+};
+
+uint64_t hash_bytes(std::string_view data);
+uint64_t hash_file(const std::string& path);
+std::optional<CachedAnswer> cache_lookup(const CacheKey& key);
+void cache_store(const CacheKey& key, Answer answer, bool verified);
+
+// Empty directory for tests, removed with the object. As a cache, it
+// stands in for $AOC2025_CACHE meanwhile.
+class ScratchDir {
+public:
+    explicit ScratchDir(bool as_cache = false);
+    ~ScratchDir();
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir(ScratchDir&&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+    ScratchDir& operator=(ScratchDir&&) = delete;
+
+    [[nodiscard]] const std::filesystem::path& path() const { return m_path; }
+
+private:
+    std::filesystem::path m_path;
+    bool m_as_cache;
+    std::optional<std::string> m_previous_cache;
+};
+
 #define CHECK(cond)							\
     if (!(cond)) {							\
 	throw std::runtime_error(					\
@@ -22,6 +87,401 @@ std::vector<std::string> split_lines(const std::string& str);
 
 #define UNUSED(var) ((void)var)
 
+// Binary snapshots of parsed inputs, kept next to the answer cache so
+// that a warm start skips text parsing. A snapshot is a header (magic,
+// format version, day, part, hashes of the solver version, of the input
+// and of everything after the header) followed by a list of arrays of
+// trivially copyable values, each 8-byte aligned, and is read back
+// through a read-only mapping.
+constexpr uint64_t MODEL_FORMAT = 2;
+
+// Smaller inputs parse faster than a lookup, and are never cached
+constexpr size_t MODEL_CACHE_MIN_BYTES = 64 * 1024;
+
+class ModelWriter {
+public:
+    template <typename T>
+    void add(std::span<const T> values);
+    template <typename T>
+    void add(const std::vector<T>& values) { add(std::span<const T>(values)); }
+
+    [[nodiscard]] std::string encode(const CacheKey& key) const;
+
+private:
+    std::vector<std::string> m_arrays;
+};
+
+template <typename T>
+void ModelWriter::add(std::span<const T> values)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    const std::span<const std::byte> bytes = std::as_bytes(values);
+    m_arrays.emplace_back(reinterpret_cast<const char *>(bytes.data()), bytes.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+class ModelSnapshot {
+public:
+    // nullopt unless bytes hold a well-formed snapshot for key; storage
+    // keeps the bytes alive
+    static std::optional<ModelSnapshot> decode(std::shared_ptr<const void> storage,
+					       std::span<const std::byte> bytes, const CacheKey& key);
+
+    [[nodiscard]] size_t size() const { return m_arrays.size(); }
+    template <typename T>
+    [[nodiscard]] std::vector<T> array(size_t i) const;
+
+private:
+    std::shared_ptr<const void> m_storage;
+    std::vector<std::span<const std::byte>> m_arrays;
+};
+
+template <typename T>
+std::vector<T> ModelSnapshot::array(size_t i) const
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    const std::span<const std::byte> bytes = m_arrays.at(i);
+    CHECK(bytes.size() % sizeof(T) == 0);
+    std::vector<T> values(bytes.size() / sizeof(T));
+    if (!bytes.empty()) {
+	std::memcpy(values.data(), bytes.data(), bytes.size());
+    }
+    return values;
+}
+
+std::optional<ModelSnapshot> model_lookup(const CacheKey& key);
+void model_store(const CacheKey& key, const ModelWriter& model);
+
+// Parse input through the snapshot cache. encode(model, writer) lists the
+// arrays of a model; decode(snapshot) rebuilds it, or returns nullopt if
+// the arrays do not fit. key.input is filled in from the input.
+template <typename Parse, typename Encode, typename Decode>
+auto cached_parse(CacheKey key, std::string_view input, Parse parse, Encode encode, Decode decode)
+    -> decltype(parse(input))
+{
+    if (input.size() < MODEL_CACHE_MIN_BYTES) {
+	return parse(input);
+    }
+    key.input = hash_bytes(input);
+    if (const std::optional<ModelSnapshot> snapshot = model_lookup(key)) {
+	if (auto model = decode(*snapshot)) {
+	    return std::move(*model);
+	}
+    }
+    auto model = parse(input);
+    ModelWriter writer;
+    encode(model, writer);
+    model_store(key, writer);
+    return model;
+}
+
+// Allocation accounting, compiled in with MEMSTATS=1: memstats.cpp then
+// replaces the global operator new/delete with counting versions.
+struct AllocStats {
+    uint64_t count{0};
+    uint64_t bytes{0};
+    int64_t live{0};
+    int64_t peak{0}; // Highest live since the last alloc_reset_peak
+};
+
+AllocStats alloc_stats(); // Of the whole process
+void alloc_reset_peak();
+int64_t peak_rss_kb();
+
+// Allocations and peak RSS growth between construction and stop(),
+// reported on stderr as one JSON line. Does nothing without MEMSTATS=1.
+class MemoryPhase {
+public:
+    MemoryPhase();
+    void stop();
+    void report(int day, std::string_view phase) const;
+
+private:
+    AllocStats m_start;
+    AllocStats m_end;
+    int64_t m_rss_start{0};
+    int64_t m_rss_end{0};
+};
+
+// Hardware counters (cycles, instructions, cache references and misses,
+// branch misses, page faults) around start()/stop(), through
+// perf_event_open. Counters that cannot be opened are left out; on other
+// systems, or when none are permitted, report() says so once. They cover
+// the calling thread and the threads it starts after the constructor,
+// which report() gives as "threads": "caller_and_started", or only the
+// calling thread where the kernel refuses that ("caller_only").
+class PerfCounters {
+public:
+    explicit PerfCounters(bool enabled);
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters(PerfCounters&&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    PerfCounters& operator=(PerfCounters&&) = delete;
+
+    void start();
+    void stop();
+    void report(int day, std::string_view phase, size_t input_bytes) const;
+
+    // Count of an event over the last start()/stop(), if it was available
+    std::optional<uint64_t> count(std::string_view event) const;
+
+private:
+    bool m_enabled;
+    std::vector<int> m_fds; // -1 where the event is not available
+    std::vector<std::optional<uint64_t>> m_values;
+    std::string m_error;
+    bool m_inherit{false};
+};
+
+// Memory for the per-input scratch of the solvers, bumped out of blocks
+// that are kept from one input to the next: rewind() makes them one block
+// as large as they were together, so that inputs of a similar size then
+// allocate nothing from the heap. Deallocating does nothing, and nothing
+// allocated from the arena may outlive a rewind(). Thread-safe, for the
+// containers the parallel helpers grow from their workers.
+class ScratchArena : public std::pmr::memory_resource {
+public:
+    ScratchArena() = default;
+    ~ScratchArena() override = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena(ScratchArena&&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ScratchArena& operator=(ScratchArena&&) = delete;
+
+    void rewind();
+    // Bytes held in blocks
+    [[nodiscard]] size_t capacity() const;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks; // NOLINT(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+    size_t m_block_size{0}; // Of the last block, the one in use
+    size_t m_used{0}; // Bytes of the last block handed out
+    size_t m_capacity{0};
+};
+
+// Resource for the per-input scratch of the solvers on the calling
+// thread: the arena of an enclosing ScopedScratch, the default resource
+// otherwise
+std::pmr::memory_resource *scratch_memory();
+
+// Makes arena the scratch_memory() of the calling thread for its lifetime
+class ScopedScratch {
+public:
+    explicit ScopedScratch(ScratchArena& arena);
+    ~ScopedScratch();
+    ScopedScratch(const ScopedScratch&) = delete;
+    ScopedScratch(ScopedScratch&&) = delete;
+    ScopedScratch& operator=(const ScopedScratch&) = delete;
+    ScopedScratch& operator=(ScopedScratch&&) = delete;
+
+private:
+    std::pmr::memory_resource *m_previous;
+};
+
+// Reads files on a background thread ahead of their use, in the order
+// given, holding at most budget bytes of contents not yet taken. Files
+// are taken in the same order: taking one drops those listed before it.
+constexpr size_t PREFETCH_BUDGET = 256 * 1024 * 1024;
+
+struct PrefetchState;
+
+class Prefetcher {
+public:
+    explicit Prefetcher(std::vector<std::string> paths, size_t budget = PREFETCH_BUDGET);
+    ~Prefetcher();
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher(Prefetcher&&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+    Prefetcher& operator=(Prefetcher&&) = delete;
+
+    // Contents of path once read, or nullopt if it is not listed, was
+    // already taken or could not be read
+    std::optional<std::string> take(const std::string& path);
+
+private:
+    std::unique_ptr<PrefetchState> m_state;
+};
+
+struct RunOptions {
+    bool tests{false}; // Also run the runtime tests
+    bool counters{false}; // Hardware counters around each part
+    Prefetcher *prefetch{nullptr}; // Source of inputs and answers, if any
+};
+
+// Building blocks for day kernels that must also run in constant
+// expressions: no streams, no std::sto*.
+
+// Call f on the offset of every occurrence of byte in the text, in order.
+// At run time whole blocks are matched at once by the dispatched kernel.
+template <typename F>
+constexpr void for_each_match(std::string_view text, char byte, F f)
+{
+    size_t from = 0;
+    if !consteval {
+	for (; from + SCAN_BLOCK <= text.size(); from += SCAN_BLOCK) {
+	    for (uint64_t mask = match_mask(&text[from], byte); mask != 0; mask &= mask - 1) {
+		f(from + static_cast<size_t>(std::countr_zero(mask)));
+	    }
+	}
+    }
+    for (size_t pos = text.find(byte, from); pos != std::string_view::npos; pos = text.find(byte, pos + 1)) {
+	f(pos);
+    }
+}
+
+// Call f on every non-empty line of the input, in place
+template <typename F>
+constexpr void for_each_line(std::string_view input, F f)
+{
+    size_t start = 0;
+    const auto line_to = [&](size_t end) -> void {
+	const std::string_view line = input.substr(start, end - start);
+	start = end + 1;
+	if (!line.empty()) {
+	    f(line);
+	}
+    };
+    for_each_match(input, '\n', line_to);
+    if (start < input.size()) {
+	line_to(input.size());
+    }
+}
+
+// Decimal integer with optional sign, surrounding whitespace ignored
+constexpr Answer parse_integer(std::string_view str)
+{
+    const size_t first = str.find_first_not_of(" \t\r\n");
+    const size_t last = str.find_last_not_of(" \t\r\n");
+    CHECK(first != std::string_view::npos);
+    str = str.substr(first, last - first + 1);
+
+    const bool negative = str.front() == '-';
+    if (negative || str.front() == '+') {
+	str.remove_prefix(1);
+    }
+    CHECK(!str.empty());
+
+    // Malformed digits are left to the loop below, which reports them
+    if !consteval {
+	if (const std::optional<uint64_t> digits = parse_digits(str)) {
+	    const auto value = static_cast<Answer>(*digits);
+	    return negative ? -value : value;
+	}
+    }
+
+    Answer value = 0;
+    for (const char chr : str) {
+	CHECK(chr >= '0' && chr <= '9');
+	value = (value * 10) + (chr - '0'); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    return negative ? -value : value;
+}
+
+// Streaming solvers receive the input in chunks of any size and give the
+// answer at the end, so memory does not grow with the input.
+struct StreamSolver {
+    virtual void consume(std::string_view chunk) = 0;
+    virtual Answer finish() = 0;
+
+    StreamSolver() = default;
+    StreamSolver(const StreamSolver&) = delete;
+    StreamSolver(StreamSolver&&) = delete;
+    StreamSolver& operator=(const StreamSolver&) = delete;
+    StreamSolver& operator=(StreamSolver&&) = delete;
+    virtual ~StreamSolver() = default;
+};
+
+constexpr size_t STREAM_CHUNK = 64 * 1024;
+
+// Feed the stream to the solver STREAM_CHUNK bytes at a time
+Answer solve_stream(std::istream& stream, StreamSolver& solver, size_t chunk_size = STREAM_CHUNK);
+
+// Cut chunks into lines; only the unfinished last line of a chunk is
+// kept, until the chunk completing it arrives. Empty lines are passed on.
+class LineReader {
+public:
+    template <typename F>
+    void consume(std::string_view chunk, F on_line);
+    template <typename F>
+    void finish(F on_line);
+
+private:
+    std::string m_partial;
+};
+
+template <typename F>
+void LineReader::consume(std::string_view chunk, F on_line)
+{
+    size_t start = 0;
+    for_each_match(chunk, '\n', [&](size_t end) -> void {
+	const std::string_view line = chunk.substr(start, end - start);
+	if (m_partial.empty()) {
+	    on_line(line);
+	} else {
+	    m_partial += line;
+	    on_line(std::string_view(m_partial));
+	    m_partial.clear();
+	}
+	start = end + 1;
+    });
+    m_partial += chunk.substr(start);
+}
+
+template <typename F>
+void LineReader::finish(F on_line)
+{
+    if (!m_partial.empty()) {
+	on_line(std::string_view(m_partial));
+	m_partial.clear();
+    }
+}
+
+// Stream solver folding over lines
+class LineSolver : public StreamSolver {
+public:
+    void consume(std::string_view chunk) override {
+	m_reader.consume(chunk, [this](std::string_view line) { on_line(line); });
+    }
+    Answer finish() override {
+	m_reader.finish([this](std::string_view line) { on_line(line); });
+	return result();
+    }
+
+protected:
+    virtual void on_line(std::string_view line) = 0;
+    virtual Answer result() = 0;
+
+private:
+    LineReader m_reader;
+};
+
+// Inputs and answers compiled in by make EMBED=1, keyed by their path
+// under inputs/. Without it, nothing is embedded.
+#ifdef AOC2025_EMBED
+#include "embedded.hpp"
+#else
+constexpr std::optional<std::string_view> embedded_file(std::string_view /*path*/)
+{
+    return {};
+}
+#endif
+
+// solve(input) for an embedded input, nullopt otherwise. Assigned to a
+// constexpr variable, the answer is worked out by the compiler.
+template <typename F>
+constexpr std::optional<Answer> precompute(F solve, std::optional<std::string_view> input)
+{
+    if (!input) {
+	return {};
+    }
+    return solve(*input);
+}
+
 class NotImplemented : std::exception {};
 
 template <int N>
@@ -34,10 +494,26 @@ struct DayBase  {
     virtual void tests() = 0;
     virtual Answer part_1(const std::string&) = 0;
     virtual Answer part_2(const std::string&) = 0;
+    virtual std::string_view version() = 0;
+    virtual std::optional<Answer> precomputed(int part) = 0;
 
     virtual ~DayBase() = default;
 
+    // Embedded or prefetched contents of path, without any I/O
+    std::optional<std::string> preloaded(const std::string& path) {
+	if (const std::optional<std::string_view> contents = embedded_file(path)) {
+	    return std::string(*contents);
+	}
+	if (m_prefetch != nullptr) {
+	    return m_prefetch->take(path);
+	}
+	return {};
+    }
+
     std::string read_to_string(const std::string& path) {
+	if (std::optional<std::string> contents = preloaded(path)) {
+	    return std::move(*contents);
+	}
 	std::ifstream ifile(path);
 	if (ifile) {
 	    std::stringstream buffer;
@@ -47,49 +523,146 @@ struct DayBase  {
 	throw std::runtime_error("Unable to open " + path);
     }
 
+    std::string input_path() {
+	return "inputs/day" + std::to_string(N) + ".txt";
+    }
+
+    std::string answer_path(int part) {
+	return "inputs/day" + std::to_string(N) + "_" + std::to_string(part) + ".txt";
+    }
+
     std::string load_input() {
-	return read_to_string("inputs/day" + std::to_string(N) + ".txt");
+	return read_to_string(input_path());
     }
 
-    void verify_print(Answer answer, int part) {
-	std::cout << answer << std::flush;
+    // Answer every requested part from the compiler's work, or nothing
+    bool run_precomputed(std::optional<int> part) {
+	std::vector<std::pair<int, Answer>> answers;
+	for (const int ipart : {1, 2}) {
+	    if (part && *part != ipart) {
+		continue;
+	    }
+	    const std::optional<Answer> answer = precomputed(ipart);
+	    if (!answer) {
+		return false;
+	    }
+	    answers.emplace_back(ipart, *answer);
+	}
+	for (const auto& [ipart, answer] : answers) {
+	    std::cout << "Day " << N << ", Part " << ipart << " // " << std::flush;
+	    verify_print(answer, ipart, std::nullopt);
+	}
+	return true;
+    }
 
-	Answer correct;
+    std::optional<Answer> known_answer(int part) {
 	try {
-	    correct = std::stoll(
-		read_to_string("inputs/day" +  std::to_string(N)
-			       + "_" + std::to_string(part) + ".txt"));
+	    return std::stoll(read_to_string(answer_path(part)));
 	} catch(std::exception&) {
-	    std::cout << " (?)" << std::endl;
-	    return;
+	    return {};
 	}
+    }
 
-	std::cout << std::endl;
+    // Answer every requested part from the cache, or nothing at all.
+    // Unverified answers keep their "(?)", and are solved again once an
+    // answer file can check them.
+    bool run_cached(std::optional<int> part, uint64_t input_hash) {
+	std::vector<std::pair<int, CachedAnswer>> answers;
+	for (const int ipart : {1, 2}) {
+	    if (part && *part != ipart) {
+		continue;
+	    }
+	    const std::optional<CachedAnswer> cached = cache_lookup({N, ipart, version(), input_hash});
+	    if (!cached || (!cached->verified && known_answer(ipart))) {
+		return false;
+	    }
+	    answers.emplace_back(ipart, *cached);
+	}
+	for (const auto& [ipart, cached] : answers) {
+	    std::cout << "Day " << N << ", Part " << ipart << " // " << cached.answer
+		      << (cached.verified ? "" : " (?)") << " (cached)" << std::endl;
+	}
+	return true;
+    }
 
-	if (correct == answer) {
-	} else {
+    void verify_print(Answer answer, int part, std::optional<uint64_t> input_hash) {
+	std::cout << answer << std::flush;
+
+	const std::optional<Answer> correct = known_answer(part);
+	std::cout << (correct ? "" : " (?)") << std::endl;
+
+	if (correct && *correct != answer) {
 	    throw std::runtime_error(
 		"Answer given: " + std::to_string(answer)
-		+ " does not match known answer: " + std::to_string(correct));
+		+ " does not match known answer: " + std::to_string(*correct));
+	}
+	if (input_hash) {
+	    cache_store({N, part, version(), *input_hash}, answer, correct.has_value());
 	}
     }
     
-    int run(std::optional<int> part) {
-	std::cout << "Day " << N << ", Tests  // " << std::flush;
+    // The worked examples are static_asserts in each day; the runtime
+    // tests only run when asked for.
+    int run(std::optional<int> part, const RunOptions& options = {}) {
+	if (options.tests) {
+	    std::cout << "Day " << N << ", Tests  // " << std::flush;
+	    MemoryPhase phase;
+	    try {
+		tests();
+		phase.stop();
+		std::cout << "PASS" << std::endl;
+	    } catch(NotImplemented&) {
+		phase.stop();
+		std::cout << "Not Implemented" << std::endl;
+	    }
+	    phase.report(N, "tests");
+	}
+
+	m_prefetch = options.prefetch;
+	if (run_precomputed(part)) {
+	    return EXIT_SUCCESS;
+	}
+
+	// Embedded inputs skip the answer cache, which lives on disk
+	const bool embedded = embedded_file(input_path()).has_value();
+	std::optional<std::string> prefetched = preloaded(input_path());
+
+	std::optional<uint64_t> input_hash;
 	try {
-	    tests();
-	    std::cout << "PASS" << std::endl;
-	} catch(NotImplemented&) {
-	    std::cout << "Not Implemented" << std::endl;
+	    if (!embedded) {
+		input_hash = prefetched ? hash_bytes(*prefetched) : hash_file(input_path());
+	    }
+	} catch (std::exception&) {
+	    // Missing input: reported by load_input below
+	}
+	if (input_hash && run_cached(part, *input_hash)) {
+	    return EXIT_SUCCESS;
 	}
 
-	std::string input = load_input();
+	MemoryPhase load_phase;
+	std::string input = prefetched ? std::move(*prefetched) : load_input();
+	load_phase.stop();
+	load_phase.report(N, "load");
+
+	PerfCounters counters(options.counters);
+	// Counters only follow threads started after them: the pool of the
+	// parallel solvers is started afresh under them
+	std::optional<ScopedThreads> fresh_pool;
+	if (options.counters) {
+	    fresh_pool.emplace(parallel_threads());
+	}
 
 	if (!part || *part == 1) {
 	    std::cout << "Day " << N << ", Part 1 // " << std::flush;
 	    try {
+		MemoryPhase phase;
+		counters.start();
 		Answer ans_1 = part_1(input);
-		verify_print(ans_1, 1);
+		counters.stop();
+		phase.stop();
+		verify_print(ans_1, 1, input_hash);
+		phase.report(N, "part_1");
+		counters.report(N, "part_1", input.size());
 	    } catch(NotImplemented&) {
 		std::cout << "Not Implemented" << std::endl;
 	    }
@@ -98,8 +671,14 @@ struct DayBase  {
 	if (!part || *part == 2) {
 	    std::cout << "Day " << N << ", Part 2 // " << std::flush;
 	    try {
+		MemoryPhase phase;
+		counters.start();
 		Answer ans_2 = part_2(input);
-		verify_print(ans_2, 2);
+		counters.stop();
+		phase.stop();
+		verify_print(ans_2, 2, input_hash);
+		phase.report(N, "part_2");
+		counters.report(N, "part_2", input.size());
 	    } catch(NotImplemented&) {
 		std::cout << "Not Implemented" << std::endl;
 	    }
@@ -107,6 +686,9 @@ struct DayBase  {
 
 	return EXIT_SUCCESS;
     }
+
+private:
+    Prefetcher *m_prefetch{nullptr};
 };
 
 
@@ -115,6 +697,8 @@ struct DayBase  {
     void tests();							\
     Answer part_1(const std::string&);					\
     Answer part_2(const std::string&);					\
+    std::string_view version();						\
+    std::optional<Answer> precomputed(int part);			\
     }									\
     template <> struct Day<N> : DayBase<N> {				\
 	void tests() override { day##N::tests(); }			\
@@ -124,72 +708,234 @@ struct DayBase  {
 	Answer part_2(const std::string& input) override {		\
 	    return day##N::part_2(input);				\
 	}								\
+	std::string_view version() override {				\
+	    return day##N::version();					\
+	}								\
+	std::optional<Answer> precomputed(int part) override {		\
+	    return day##N::precomputed(part);				\
+	}								\
     }
 
+// Non-owning grid over a buffer whose rows are stride elements apart,
+// e.g. a text input where every row of ncols cells ends with a newline.
+template <typename T>
+struct GridView {
+    constexpr GridView() {}
+    constexpr GridView(std::span<T> data, size_t rows, size_t cols, size_t row_stride);
+    size_t nrows{0};
+    size_t ncols{0};
+    size_t stride{0};
+    constexpr size_t idx(size_t i, size_t j) const;
+    constexpr T& at(size_t i, size_t j) const;
+    constexpr std::span<T> row(size_t i) const;
+    std::span<T> m_data{};
+};
+
+template <typename T>
+constexpr GridView<T>::GridView(std::span<T> data, size_t rows, size_t cols, size_t row_stride)
+    : nrows{rows}, ncols{cols}, stride{row_stride}, m_data{data}
+{
+    CHECK(nrows == 0 || (nrows - 1) * stride + ncols <= m_data.size());
+}
+
 template <typename T>
+constexpr size_t GridView<T>::idx(size_t i, size_t j) const
+{
+    CHECK(i < nrows);
+    CHECK(j < ncols);
+    return i * stride + j;
+}
+
+template <typename T>
+constexpr T& GridView<T>::at(size_t i, size_t j) const
+{
+    return m_data[idx(i, j)];
+}
+
+template <typename T>
+constexpr std::span<T> GridView<T>::row(size_t i) const
+{
+    CHECK(i < nrows);
+    return m_data.subspan(i * stride, ncols);
+}
+
+// View a text input as a grid in place, checking that it is rectangular.
+// Newlines are counted in one branch-free pass the compiler vectorizes;
+// with one newline per row, all at the expected offsets, every row has
+// the same width.
+constexpr GridView<const char> text_grid(std::string_view input)
+{
+    const size_t last = input.find_last_not_of('\n');
+    if (last == std::string_view::npos) {
+	return {};
+    }
+    input = input.substr(0, last + 1);
+
+    const size_t ncols = std::min(input.find('\n'), input.size());
+    const size_t stride = ncols + 1;
+    CHECK((input.size() + 1) % stride == 0);
+    const size_t nrows = (input.size() + 1) / stride;
+
+    size_t newlines = 0;
+    for (const char chr : input) {
+	newlines += static_cast<size_t>(chr == '\n');
+    }
+    CHECK(newlines == nrows - 1);
+    for (size_t i = 1; i < nrows; i++) {
+	CHECK(input[(i * stride) - 1] == '\n');
+    }
+
+    return {std::span<const char>(input.data(), input.size()), nrows, ncols, stride};
+}
+
+// Call band(first, last) on [0, n) split into jobs bands of rows, each on
+// its own thread
+void run_bands(size_t n, size_t jobs, const std::function<void(size_t, size_t)>& band);
+
+// Storage orders for Grid. A layout maps (i, j) to an offset in a buffer
+// of size() elements; rows need not be contiguous.
+struct RowMajor {
+    constexpr RowMajor() {}
+    constexpr RowMajor(size_t rows, size_t cols) : nrows{rows}, ncols{cols} {}
+    size_t nrows{0};
+    size_t ncols{0};
+    constexpr size_t size() const { return nrows * ncols; }
+    constexpr size_t index(size_t i, size_t j) const { return i * ncols + j; }
+};
+
+// TILE x TILE blocks, each row-major, blocks in row-major order: a cell
+// and its eight neighbours mostly share a block. Edge blocks are padded.
+template <size_t TILE = 64>
+struct Tiled {
+    static_assert(TILE > 0 && (TILE & (TILE - 1)) == 0);
+    constexpr Tiled() {}
+    constexpr Tiled(size_t rows, size_t cols) : nrows{rows}, ncols{cols}, tile_cols{(cols + TILE - 1) / TILE} {}
+    size_t nrows{0};
+    size_t ncols{0};
+    size_t tile_cols{0};
+    constexpr size_t size() const { return ((nrows + TILE - 1) / TILE) * tile_cols * TILE * TILE; }
+    constexpr size_t index(size_t i, size_t j) const {
+	return ((((i / TILE) * tile_cols) + (j / TILE)) * TILE * TILE) + ((i % TILE) * TILE) + (j % TILE);
+    }
+};
+
+// Z-order: the bits of i and j interleaved, so that nearby cells are
+// nearby in memory at every scale. Both sides are padded to powers of
+// two; the high bits of the longer side, past the shorter one, go on top.
+struct Morton {
+    constexpr Morton() {}
+    constexpr Morton(size_t rows, size_t cols)
+	: nrows{rows}, ncols{cols},
+	  row_bits{static_cast<size_t>(std::bit_width(std::bit_ceil(std::max<size_t>(rows, 1)) - 1))},
+	  col_bits{static_cast<size_t>(std::bit_width(std::bit_ceil(std::max<size_t>(cols, 1)) - 1))} {}
+    size_t nrows{0};
+    size_t ncols{0};
+    size_t row_bits{0};
+    size_t col_bits{0};
+    constexpr size_t size() const { return size_t{1} << (row_bits + col_bits); }
+    constexpr size_t index(size_t i, size_t j) const {
+	const size_t shared = std::min(row_bits, col_bits);
+	const size_t low = (size_t{1} << shared) - 1;
+	const size_t high = (i >> shared) | (j >> shared); // Only one side has high bits
+	return (high << (2 * shared)) | (spread(i & low) << 1) | spread(j & low);
+    }
+
+    // Bits of x moved to the even positions
+    static constexpr size_t spread(size_t x) {
+	x &= 0xffffffff; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	x = (x | (x << 16)) & 0x0000ffff0000ffff; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	x = (x | (x << 8)) & 0x00ff00ff00ff00ff; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	x = (x | (x << 2)) & 0x3333333333333333; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	x = (x | (x << 1)) & 0x5555555555555555; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	return x;
+    }
+};
+
+// at(i) and ref(i) address the storage directly, in the layout's order
+template <typename T, typename Layout = RowMajor>
 struct Grid {
-    Grid() {}
+    constexpr Grid() {}
     template <typename F>
-    Grid(const std::string& input, F f);
+    constexpr Grid(std::string_view input, F f);
+    template <typename F>
+    constexpr Grid(const GridView<const char>& view, F f, size_t jobs = 1);
     size_t nrows{0};
     size_t ncols{0};
-    size_t idx(size_t i, size_t j) const;
-    const T& at(size_t i) const;
-    const T& at(size_t i, size_t j) const;
-    T& ref(size_t i);
-    T& ref(size_t i, size_t j);
+    constexpr size_t idx(size_t i, size_t j) const;
+    constexpr const T& at(size_t i) const;
+    constexpr const T& at(size_t i, size_t j) const;
+    constexpr T& ref(size_t i);
+    constexpr T& ref(size_t i, size_t j);
+    Layout m_layout{};
     std::vector<T> m_buf{};
 };
 
-template <typename T>
+template <typename T, typename Layout>
 template <typename F>
-Grid<T>::Grid(const std::string& input, F f)
+constexpr Grid<T, Layout>::Grid(std::string_view input, F f)
+    : Grid(text_grid(input), f)
 {
-    std::vector<std::string> lines = split_lines(input);
-
-    if (lines.empty())
-	return;
+}
 
-    nrows = lines.size();
-    ncols = lines.front().size();
-    m_buf.resize(nrows * ncols);
-    
-    for (size_t i = 0; i < nrows; i++) {
-	CHECK(lines.at(i).size() == ncols);
-	for (size_t j = 0; j < ncols; j++) {
-	    m_buf.at(idx(i, j)) = f(i, j, lines.at(i).at(j));
+// Storage is sized once and every row filled by a plain loop over the
+// view; with jobs > 1, bands of rows are filled in parallel, so f must
+// then be safe to call concurrently. Padding cells are value-initialized.
+template <typename T, typename Layout>
+template <typename F>
+constexpr Grid<T, Layout>::Grid(const GridView<const char>& view, F f, size_t jobs)
+    : nrows{view.nrows}, ncols{view.ncols}, m_layout(view.nrows, view.ncols), m_buf(m_layout.size())
+{
+    const auto fill = [&](size_t first, size_t last) {
+	for (size_t i = first; i < last; i++) {
+	    const std::span<const char> cells = view.row(i);
+	    if constexpr (std::is_same_v<Layout, RowMajor>) {
+		const std::span<T> out = std::span<T>(m_buf).subspan(i * ncols, ncols);
+		for (size_t j = 0; j < ncols; j++) {
+		    out[j] = f(i, j, cells[j]);
+		}
+	    } else {
+		for (size_t j = 0; j < ncols; j++) {
+		    m_buf[m_layout.index(i, j)] = f(i, j, cells[j]);
+		}
+	    }
 	}
+    };
+    if (jobs <= 1 || nrows < 2 * jobs) {
+	fill(0, nrows);
+    } else {
+	run_bands(nrows, jobs, fill);
     }
 }
 
-template <typename T>
-size_t Grid<T>::idx(size_t i, size_t j) const
+template <typename T, typename Layout>
+constexpr size_t Grid<T, Layout>::idx(size_t i, size_t j) const
 {
     CHECK(i < nrows);
     CHECK(j < ncols);
-    return i * nrows + j;
+    return m_layout.index(i, j);
 }
 
-template <typename T>
-const T& Grid<T>::at(size_t i) const
+template <typename T, typename Layout>
+constexpr const T& Grid<T, Layout>::at(size_t i) const
 {
     return m_buf.at(i);
 }
 
-template <typename T>
-const T& Grid<T>::at(size_t i, size_t j) const
+template <typename T, typename Layout>
+constexpr const T& Grid<T, Layout>::at(size_t i, size_t j) const
 {
     return at(idx(i, j));
 }
 
-template <typename T>
-T& Grid<T>::ref(size_t i)
+template <typename T, typename Layout>
+constexpr T& Grid<T, Layout>::ref(size_t i)
 {
     return m_buf.at(i);
 }
 
-template <typename T>
-T& Grid<T>::ref(size_t i, size_t j)
+template <typename T, typename Layout>
+constexpr T& Grid<T, Layout>::ref(size_t i, size_t j)
 {
     return m_buf.at(idx(i, j));
 }
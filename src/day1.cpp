@@ -1,24 +1,36 @@
 #include <algorithm>
-#include <cmath>
 #include <iostream> // NOLINT(misc-include-cleaner)
 #include <iterator>
+#include <memory>
 #include <numeric>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "commands.hpp"
 #include "common.hpp"
+#include "pipeline.hpp"
 
 namespace day1 {
 
+auto version() -> std::string_view { return SOURCE_HASH; }
+
 constexpr int INITIAL_DIAL = 50;
 constexpr int MAX_DIAL = 100;
 
 
-auto remove_full_turns(int& rot) -> int {
+constexpr auto magnitude(int value) -> int {
+    return value < 0 ? -value : value;
+}
+
+constexpr auto remove_full_turns(int& rot) -> int {
     // Start by counting full rotations
-    const int turns = std::abs(rot) / MAX_DIAL;
+    const int turns = magnitude(rot) / MAX_DIAL;
     if (rot > 0) {
 	rot -= turns * MAX_DIAL;
     }
@@ -28,7 +40,7 @@ auto remove_full_turns(int& rot) -> int {
     return turns;
 }
 
-auto rotate(int dial, int rot) -> int
+constexpr auto rotate(int dial, int rot) -> int
 {
     (void)remove_full_turns(rot);
     int dst = dial + rot;
@@ -38,7 +50,7 @@ auto rotate(int dial, int rot) -> int
     return dst % MAX_DIAL;
 }
 
-auto parserot(const std::string& rotstr) -> int
+constexpr auto parserot(std::string_view rotstr) -> int
 {
     int sign = 0;
     switch (rotstr.at(0)) {
@@ -52,12 +64,12 @@ auto parserot(const std::string& rotstr) -> int
 	throw std::runtime_error("invalid rot str");
     }
 
-    const int rot = std::stoi(rotstr.substr(1));
+    const auto rot = static_cast<int>(parse_integer(rotstr.substr(1)));
 
     return sign * rot;
 }
 
-auto getpass(const std::vector<int>& moves, int dial = INITIAL_DIAL) -> int
+constexpr auto getpass(const std::vector<int>& moves, int dial = INITIAL_DIAL) -> int
 {
     auto acc = std::accumulate(
 	moves.begin(), moves.end(), std::make_pair(dial, 0),
@@ -69,20 +81,19 @@ auto getpass(const std::vector<int>& moves, int dial = INITIAL_DIAL) -> int
 }
 
 
-auto getmoves(const std::string& input) -> std::vector<int> 
+constexpr auto getmoves(std::string_view input) -> std::vector<int> 
 {
     std::vector<int> moves;
-    std::vector<std::string> smoves = split_lines(input);
-    std::ranges::transform(smoves, std::back_inserter(moves), parserot);
+    for_each_line(input, [&](std::string_view line) -> void { moves.push_back(parserot(line)); });
     return moves;
 }
 
-auto part_1(const std::string& input) -> Answer
+constexpr auto solve_1(std::string_view input) -> Answer
 {
     return getpass(getmoves(input));
 }
 
-auto crosses_zero(int dial, int rot) -> Answer
+constexpr auto crosses_zero(int dial, int rot) -> Answer
 {
     int crossings = remove_full_turns(rot);
 
@@ -95,14 +106,14 @@ auto crosses_zero(int dial, int rot) -> Answer
 
     // if rotation is qeg to that distance, there was either a crossing or we ended on 0
     // don't count if we starts on 0
-    if (std::abs(rot) >= dist0) {
+    if (magnitude(rot) >= dist0) {
 	crossings++;
     }
 
     return crossings;
 }
 
-auto getpass_0x434C49434B(const std::vector<int>& moves) -> Answer
+constexpr auto getpass_0x434C49434B(const std::vector<int>& moves) -> Answer
 {
     auto acc = std::accumulate(
 	moves.begin(), moves.end(), std::make_pair(INITIAL_DIAL, 0),
@@ -115,11 +126,114 @@ auto getpass_0x434C49434B(const std::vector<int>& moves) -> Answer
 }
 
 
-auto part_2(const std::string& input) -> Answer
+constexpr auto solve_2(std::string_view input) -> Answer
 {
   return getpass_0x434C49434B(getmoves(input));
 }
 
+// Both passwords as a fold over the moves: only the dial and the count
+// are kept, whatever the length of the input.
+class PassCounter {
+public:
+    explicit PassCounter(bool any_click) : m_any_click{any_click} {}
+
+    void add(int move) {
+	if (m_any_click) {
+	    m_count += crosses_zero(m_dial, move);
+	}
+	m_dial = rotate(m_dial, move);
+	if (!m_any_click && m_dial == 0) {
+	    m_count++;
+	}
+    }
+    [[nodiscard]] Answer result() const { return m_count; }
+
+private:
+    bool m_any_click;
+    int m_dial{INITIAL_DIAL};
+    Answer m_count{0};
+};
+
+// Moves are parsed as the chunks arrive, while the worker turns the dial
+// over the batches already parsed
+class PassSolver : public StreamSolver {
+public:
+    explicit PassSolver(bool any_click) : m_counter{any_click} {}
+
+    void consume(std::string_view chunk) override {
+	m_reader.consume(chunk, [this](std::string_view line) -> void { on_line(line); });
+    }
+    Answer finish() override {
+	m_reader.finish([this](std::string_view line) -> void { on_line(line); });
+	m_moves.finish();
+	return m_counter.result();
+    }
+
+private:
+    void on_line(std::string_view line) {
+	if (!line.empty()) {
+	    m_moves.push(parserot(line));
+	}
+    }
+
+    LineReader m_reader;
+    PassCounter m_counter;
+    Pipeline<int> m_moves{[this](std::span<const int> moves) -> void {
+	for (const int move : moves) {
+	    m_counter.add(move);
+	}
+    }};
+};
+
+auto stream_solver(int part) -> std::unique_ptr<StreamSolver>
+{
+    return std::make_unique<PassSolver>(part == 2);
+}
+
+// Same fold as solve_1 and solve_2, without the vector of moves
+auto pipelined_pass(std::string_view input, bool any_click) -> Answer
+{
+    PassSolver solver(any_click);
+    solver.consume(input);
+    return solver.finish();
+}
+
+auto part_1(const std::string& input) -> Answer
+{
+    return pipelined_pass(input, false);
+}
+
+auto part_2(const std::string& input) -> Answer
+{
+    return pipelined_pass(input, true);
+}
+
+constexpr std::string_view EXAMPLE =
+    "L68\n"
+    "L30\n"
+    "R48\n"
+    "L5\n"
+    "R60\n"
+    "L55\n"
+    "L1\n"
+    "L99\n"
+    "R14\n"
+    "L82\n";
+
+static_assert(rotate(0, -1) == 99);
+static_assert(parserot("L68") == -68);
+static_assert(crosses_zero(INITIAL_DIAL, 1000) == 10);
+static_assert(solve_1(EXAMPLE) == 3);
+static_assert(solve_2(EXAMPLE) == 6);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute(solve_1, embedded_file("inputs/day1.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute(solve_2, embedded_file("inputs/day1.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
+}
+
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
     // NOLINTBEGIN(bugprone-assignment-in-if-condition)
@@ -142,17 +256,7 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     //////////////////////////////////////////////
 
-    const std::string test_input_1 = 
-	"L68\n"
-	"L30\n"
-	"R48\n"
-	"L5\n"
-	"R60\n"
-	"L55\n"
-	"L1\n"
-	"L99\n"
-	"R14\n"
-	"L82\n";
+    const std::string test_input_1(EXAMPLE);
     
     std::vector<std::string> moves = split_lines(test_input_1);
 
@@ -216,6 +320,71 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     dial = 0;
     CHECK(rotate(dial, -377) == (MAX_DIAL - 77));
+
+    // Moves split across chunks, down to one byte per chunk
+    for (const size_t chunk : {1, 2, 3, 5, 64}) {
+	std::istringstream stream_1(test_input_1);
+	CHECK(solve_stream(stream_1, *stream_solver(1), chunk) == 3);
+	std::istringstream stream_2(test_input_1);
+	CHECK(solve_stream(stream_2, *stream_solver(2), chunk) == 6);
+    }
+
+    // Enough moves to fill the ring, so that the parser waits on the fold
+    std::string long_input;
+    for (size_t i = 0; i < PIPELINE_BATCH * PIPELINE_DEPTH * 2; i++) {
+	long_input += (i % 3 == 0 ? "L" : "R") + std::to_string((i * 37) % 1000) + "\n"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    CHECK(part_1(long_input) == solve_1(long_input));
+    CHECK(part_2(long_input) == solve_2(long_input));
+
+    // Lines and integers come out the same from every kernel variant this
+    // CPU runs, the scalar one giving the reference
+    Answer long_1 = 0;
+    Answer long_2 = 0;
+    {
+	const ScopedIsa scalar(Isa::Scalar);
+	long_1 = part_1(long_input);
+	long_2 = part_2(long_input);
+    }
+    for (const Isa variant : ISAS) {
+	if (!isa_supported(variant)) {
+	    continue;
+	}
+	const ScopedIsa forced(variant);
+	CHECK(part_1(long_input) == long_1);
+	CHECK(part_2(long_input) == long_2);
+	CHECK(parse_integer("9007199254740993") == 9007199254740993); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(parse_integer("1234567890123456789") == 1234567890123456789); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(parse_integer(" -0042\r") == -42); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	const std::string digits = "9081726354453627189";
+	for (size_t length = 1; length <= digits.size(); length++) {
+	    CHECK(parse_integer(digits.substr(0, length)) == std::stoll(digits.substr(0, length)));
+	}
+	bool malformed = false;
+	try {
+	    UNUSED(parse_integer("12:4"));
+	} catch (std::runtime_error&) {
+	    malformed = true;
+	}
+	CHECK(malformed);
+    }
+
+    // A failing fold stops the worker; the error comes out of finish
+    Pipeline<int> failing([](std::span<const int> moves) -> void {
+	if (std::ranges::find(moves, 0) != moves.end()) {
+	    throw std::runtime_error("no move");
+	}
+    }, 2);
+    for (const int move : {1, 2, 0, 3, 4, 5, 6}) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	failing.push(move);
+    }
+    bool failed = false;
+    try {
+	failing.finish();
+    } catch (std::runtime_error&) {
+	failed = true;
+    }
+    CHECK(failed);
 	
     
     // NOLINTEND(bugprone-assignment-in-if-condition)
@@ -1,33 +1,70 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
-#include <iterator>
+#include <memory_resource>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "common.hpp"
+#include "parallel.hpp"
 
 namespace day2 {
 
-auto generate_invalid(const std::string& id_str, size_t n = 2) -> std::string {
+auto version() -> std::string_view { return SOURCE_HASH; }
+
+// The id written n times in a row
+constexpr auto generate_invalid(Answer id, size_t n = 2) -> Answer {
     CHECK(n >= 2);
-    std::string inv = id_str;
+    Answer shift = 1;
+    for (Answer rest = id; rest > 0; rest /= 10) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	shift *= 10; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    Answer inv = id;
     for (size_t i = 1; i < n; i++) {
-	inv += id_str;
+	inv = (inv * shift) + id;
     }
     return inv;
 }
 
-auto generate_all_invalids(const std::string& start, const std::string& end, bool single = true) -> std::vector<Answer> {
-    const Answer istart = std::stoll(start);
-    const Answer iend = std::stoll(end);
+constexpr auto count_digits(Answer value) -> size_t {
+    size_t digits = 1;
+    for (; value >= 10; value /= 10) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	digits++;
+    }
+    return digits;
+}
+
+// Smallest id whose n-fold repetition can reach start: shorter ids give
+// too few digits, and ids below the leading digits of start give smaller
+// numbers. Keeps the enumeration short enough for constant evaluation.
+constexpr auto first_candidate(Answer start, size_t n) -> Answer {
+    const size_t digits = count_digits(start);
+    const size_t width = (digits + n - 1) / n;
+    Answer first = 1;
+    for (size_t i = 1; i < width; i++) {
+	first *= 10; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    if (width * n == digits) {
+	first = start;
+	for (size_t i = width; i < digits; i++) {
+	    first /= 10; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	}
+    }
+    return first;
+}
+
+constexpr auto generate_all_invalids(std::string_view start, std::string_view end, bool single = true) -> std::vector<Answer> {
+    const Answer istart = parse_integer(start);
+    const Answer iend = parse_integer(end);
     std::vector<Answer> invalids;
 
-    for (size_t i = 2; i <= (single ? 2 : end.size()); i++) {
-	for (Answer j = 1; j <= iend; j++) {
-	    const Answer cand = std::stoll(generate_invalid(std::to_string(j), i));
+    for (size_t i = 2; i <= (single ? 2 : count_digits(iend)); i++) {
+	for (Answer j = first_candidate(istart, i); j <= iend; j++) {
+	    const Answer cand = generate_invalid(j, i);
 	    if (cand < istart) {
 		continue;
 	    }
@@ -42,46 +79,90 @@ auto generate_all_invalids(const std::string& start, const std::string& end, boo
     return invalids;
 }
 
-auto sum_all_invalids(const std::pair<std::string, std::string>& range, bool single = true) -> Answer {
+constexpr auto sum_all_invalids(const std::pair<std::string_view, std::string_view>& range, bool single = true) -> Answer {
     const std::vector<Answer> invalids = generate_all_invalids(range.first, range.second, single);
-    return std::accumulate(invalids.begin(), invalids.end(), 0LL);
+    return std::accumulate(invalids.begin(), invalids.end(), Answer{0});
 }
 
-auto to_range(const std::string& entry) -> std::pair<std::string, std::string> {
-    std::vector<std::string> vecpair = split_at(entry, '-');
-    CHECK(vecpair.size() == 2);
-    return std::make_pair(vecpair[0], vecpair[1]);
+constexpr auto to_range(std::string_view entry) -> std::pair<std::string_view, std::string_view> {
+    const size_t dash = entry.find('-');
+    CHECK(dash != std::string_view::npos);
+    return std::make_pair(entry.substr(0, dash), entry.substr(dash + 1));
 }
 
-auto part_1(const std::string& input) -> Answer
+// Call f on every range of the comma-separated list, in place
+template <typename F>
+constexpr auto for_each_range(std::string_view input, F f) -> void
 {
-    const std::vector<std::string> str_entries = split_at(input, ',');
+    while (!input.empty()) {
+	const size_t comma = std::min(input.find(','), input.size());
+	const std::string_view entry = input.substr(0, comma);
+	input.remove_prefix(std::min(comma + 1, input.size()));
+	if (entry.find_first_not_of(" \t\r\n") != std::string_view::npos) {
+	    f(to_range(entry));
+	}
+    }
+}
 
-    std::vector<std::pair<std::string, std::string>> entries;
-    std::ranges::transform(str_entries, std::back_inserter(entries), to_range);
-    
-    std::vector<Answer> partialsums;
-    std::ranges::transform(entries, std::back_inserter(partialsums), std::bind_back(sum_all_invalids, true));
+constexpr auto parse_ranges(std::string_view input) -> std::vector<std::pair<std::string_view, std::string_view>>
+{
+    std::vector<std::pair<std::string_view, std::string_view>> ranges;
+    for_each_range(input, [&](const auto& range) -> void { ranges.push_back(range); });
+    return ranges;
+}
 
-    return std::accumulate(partialsums.begin(), partialsums.end(), 0LL);
+constexpr auto solve(std::string_view input, bool single) -> Answer
+{
+    Answer sum = 0;
+    for (const auto& range : parse_ranges(input)) {
+	sum += sum_all_invalids(range, single);
+    }
+    return sum;
+}
+
+// Ranges differ widely in size, so every one of them may be a chunk
+auto parallel_solve(std::string_view input, bool single) -> Answer
+{
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> ranges(scratch_memory());
+    for_each_range(input, [&](const auto& range) -> void { ranges.push_back(range); });
+    return parallel_reduce(ranges.size(), Answer{0}, [&](size_t first, size_t last) -> Answer {
+	Answer sum = 0;
+	for (size_t i = first; i < last; i++) {
+	    sum += sum_all_invalids(ranges[i], single);
+	}
+	return sum;
+    }, std::plus<>());
+}
+
+auto part_1(const std::string& input) -> Answer
+{
+    return parallel_solve(input, true);
 }
 
 auto part_2(const std::string& input) -> Answer
 {
-    const std::vector<std::string> str_entries = split_at(input, ',');
+    return parallel_solve(input, false);
+}
 
-    std::vector<std::pair<std::string, std::string>> entries;
-    std::ranges::transform(str_entries, std::back_inserter(entries), to_range);
-    
-    std::vector<Answer> partialsums;
-    std::ranges::transform(entries, std::back_inserter(partialsums), std::bind_back(sum_all_invalids, false));
+constexpr std::string_view EXAMPLE = "11-22,95-115,998-1012,1188511880-1188511890,222220-222224,1698522-1698528,446443-446449,38593856-38593862,565653-565659,824824821-824824827,2121212118-2121212124\n";
+
+static_assert(generate_invalid(12, 3) == 121212);
+static_assert(first_candidate(1188511880, 2) == 11885);
+static_assert(first_candidate(998, 2) == 10);
+static_assert(solve(EXAMPLE, true) == 1227775554);
+static_assert(solve(EXAMPLE, false) == 4174379265);
 
-    return std::accumulate(partialsums.begin(), partialsums.end(), 0LL);
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute([](std::string_view input) -> Answer { return solve(input, true); }, embedded_file("inputs/day2.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute([](std::string_view input) -> Answer { return solve(input, false); }, embedded_file("inputs/day2.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
 }
 
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
-    CHECK(generate_invalid("1") == "11");
+    CHECK(generate_invalid(1) == 11);
 
     CHECK(generate_all_invalids("11", "22") == std::vector<Answer>({11, 22}));
     CHECK(generate_all_invalids("95", "115") == std::vector<Answer>({99}));
@@ -97,14 +178,14 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     CHECK(sum_all_invalids(std::make_pair("11", "22")) == (11 + 22));
 
-    CHECK(to_range("11-22") == std::make_pair("11", "22"));
+    CHECK(to_range("11-22") == std::make_pair(std::string_view("11"), std::string_view("22")));
 
-    const std::string test_input_1 = "11-22,95-115,998-1012,1188511880-1188511890,222220-222224,1698522-1698528,446443-446449,38593856-38593862,565653-565659,824824821-824824827,2121212118-2121212124";
+    const std::string test_input_1(EXAMPLE);
 
     CHECK(part_1(test_input_1) == 1227775554);
 
-    CHECK(generate_invalid("9", 3) == "999");
-    CHECK(generate_invalid("2", 6) == "222222");
+    CHECK(generate_invalid(9, 3) == 999);
+    CHECK(generate_invalid(2, 6) == 222222);
 
     CHECK(generate_all_invalids("11", "22", false) == std::vector<Answer>({11, 22}));
     CHECK(generate_all_invalids("95", "115", false) == std::vector<Answer>({99, 111}));
@@ -120,6 +201,13 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     CHECK(part_2(test_input_1) == 4174379265);
 
+    // Same answers whatever the number of threads
+    for (const size_t n_threads : {1, 3, 8}) {
+	const ScopedThreads scoped(n_threads);
+	CHECK(part_1(test_input_1) == 1227775554);
+	CHECK(part_2(test_input_1) == 4174379265);
+    }
+
     
 }
 
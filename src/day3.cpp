@@ -1,62 +1,136 @@
 #include <algorithm>
+#include <array>
 // #include <cstddef>
+#include <functional>
 #include <iterator>
-#include <numeric>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "commands.hpp"
 #include "common.hpp"
+#include "parallel.hpp"
 
 namespace day3 {
 
-auto maximum_joltage(const std::string& bank) -> Answer {
-    auto itl = std::ranges::max_element(bank.begin(), std::prev(bank.end()));
-    auto itr = std::ranges::max_element(std::next(itl), bank.end());
-    const std::string jolt({*itl, *itr});
-    return std::stoll(jolt);
+auto version() -> std::string_view { return SOURCE_HASH; }
+
+constexpr auto maximum_joltage(std::string_view bank) -> Answer {
+    const auto itl = std::ranges::max_element(bank.begin(), std::prev(bank.end()));
+    const auto itr = std::ranges::max_element(std::next(itl), bank.end());
+    const std::array<char, 2> jolt = {*itl, *itr};
+    return parse_integer(std::string_view(jolt.data(), jolt.size()));
 }
 
-auto overmaximum_joltage(const std::string& bank) -> Answer {
+constexpr auto overmaximum_joltage(std::string_view bank) -> Answer {
     const int nmax = 12;
-    std::string chosen;
+    std::array<char, nmax> chosen{};
 
     CHECK(bank.size() >= nmax);
 
     auto start = bank.begin();
     for (int i = 0; i < nmax; i++) {
-	auto end = bank.end() - nmax + i + 1;
+	const auto end = bank.end() - nmax + i + 1;
 	CHECK(end > start);
-	auto pick = std::ranges::max_element(start, end);
-	chosen.push_back(*pick);
+	const auto pick = std::ranges::max_element(start, end);
+	chosen.at(i) = *pick;
 	start = std::next(pick);
     }
 
-    return std::stoll(chosen);
+    return parse_integer(std::string_view(chosen.data(), chosen.size()));
+}
+
+template <typename F>
+constexpr auto sum_joltages(std::string_view input, F joltage) -> Answer
+{
+    Answer sum = 0;
+    for_each_line(input, [&](std::string_view bank) -> void { sum += joltage(bank); });
+    return sum;
+}
+
+constexpr auto solve_1(std::string_view input) -> Answer
+{
+    return sum_joltages(input, maximum_joltage);
+}
+
+constexpr auto solve_2(std::string_view input) -> Answer
+{
+    return sum_joltages(input, overmaximum_joltage);
+}
+
+constexpr size_t BANK_GRAIN = 64;
+
+template <typename F>
+auto parallel_sum_joltages(std::string_view input, F joltage) -> Answer
+{
+    std::pmr::vector<std::string_view> banks(scratch_memory());
+    for_each_line(input, [&](std::string_view bank) -> void { banks.push_back(bank); });
+    return parallel_reduce(banks.size(), Answer{0}, [&](size_t first, size_t last) -> Answer {
+	Answer sum = 0;
+	for (size_t i = first; i < last; i++) {
+	    sum += joltage(banks[i]);
+	}
+	return sum;
+    }, std::plus<>(), BANK_GRAIN);
 }
 
 auto part_1(const std::string& input) -> Answer
 {
-    std::vector<std::string> lines = split_lines(input);
-    std::vector<Answer> joltages;
-    std::ranges::transform(lines, std::back_inserter(joltages), maximum_joltage);
-    return std::accumulate(joltages.begin(), joltages.end(), 0LL);
+    return parallel_sum_joltages(input, maximum_joltage);
 }
 
 auto part_2(const std::string& input) -> Answer
 {
-    std::vector<std::string> lines = split_lines(input);
-    std::vector<Answer> joltages;
-    std::ranges::transform(lines, std::back_inserter(joltages), overmaximum_joltage);
-    return std::accumulate(joltages.begin(), joltages.end(), 0LL);
+    return parallel_sum_joltages(input, overmaximum_joltage);
+}
+
+// Joltage sums over a stream of banks, one bank in memory at a time
+class JoltageSolver : public LineSolver {
+public:
+    explicit JoltageSolver(bool over) : m_over{over} {}
+
+protected:
+    void on_line(std::string_view bank) override {
+	if (!bank.empty()) {
+	    m_sum += m_over ? overmaximum_joltage(bank) : maximum_joltage(bank);
+	}
+    }
+    Answer result() override { return m_sum; }
+
+private:
+    bool m_over;
+    Answer m_sum{0};
+};
+
+auto stream_solver(int part) -> std::unique_ptr<StreamSolver>
+{
+    return std::make_unique<JoltageSolver>(part == 2);
+}
+
+constexpr std::string_view EXAMPLE =
+    "987654321111111\n"
+    "811111111111119\n"
+    "234234234234278\n"
+    "818181911112111\n";
+
+static_assert(solve_1(EXAMPLE) == 357);
+static_assert(solve_2(EXAMPLE) == 3121910778619);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute(solve_1, embedded_file("inputs/day3.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute(solve_2, embedded_file("inputs/day3.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
 }
 
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
-    const std::string test_input_1 =
-	"987654321111111\n"
-	"811111111111119\n"
-	"234234234234278\n"
-	"818181911112111\n";
+    const std::string test_input_1(EXAMPLE);
 
     const std::vector<std::string> test_lines_1 = split_lines(test_input_1);
 
@@ -73,6 +147,24 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
     CHECK(overmaximum_joltage(test_lines_1.at(3)) == 888911112111);
 
     CHECK(part_2(test_input_1) == 3121910778619);
+
+    // Enough banks for several chunks
+    std::string many_banks;
+    for (size_t i = 0; i < 100; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	many_banks += test_input_1;
+    }
+    for (const size_t n_threads : {1, 4}) {
+	const ScopedThreads scoped(n_threads);
+	CHECK(part_1(many_banks) == 357 * 100);
+	CHECK(part_2(many_banks) == 3121910778619 * 100);
+    }
+
+    for (const size_t chunk : {1, 7, 16, 64}) {
+	std::istringstream stream_1(test_input_1);
+	CHECK(solve_stream(stream_1, *stream_solver(1), chunk) == 357);
+	std::istringstream stream_2(test_input_1);
+	CHECK(solve_stream(stream_2, *stream_solver(2), chunk) == 3121910778619);
+    }
     
 }
 
@@ -1,6 +1,12 @@
 #include <cstddef>
+#include <cstdint>
+#include <memory_resource>
 // #include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -8,11 +14,13 @@
 
 namespace day4 {
 
+auto version() -> std::string_view { return SOURCE_HASH; }
+
 constexpr char PAPER_SYMBOL = '@';
 constexpr char EMPTY_SYMBOL = '.';
 
-template <typename T>
-auto reachable_indices(const Grid<T>& grid, size_t i, size_t j) // NOLINT
+template <typename G>
+constexpr auto reachable_indices(const G& grid, size_t i, size_t j) // NOLINT
     -> std::vector<std::pair<size_t, size_t>> {
     std::vector<std::pair<size_t, size_t>> idx;
     const bool firsti = i == 0;
@@ -56,7 +64,8 @@ auto reachable_indices(const Grid<T>& grid, size_t i, size_t j) // NOLINT
     return idx;
 }
 
-auto is_accessible_roll(const Grid<char>& grid, size_t i, size_t j) -> bool // NOLINT
+template <typename G>
+constexpr auto is_accessible_roll(const G& grid, size_t i, size_t j) -> bool // NOLINT
 {
     if (grid.at(i, j) != PAPER_SYMBOL) {
 	return false;
@@ -74,12 +83,10 @@ auto is_accessible_roll(const Grid<char>& grid, size_t i, size_t j) -> bool // N
     return true;
 }
 
-auto part_1(const std::string& input) -> Answer
+constexpr auto solve_1(std::string_view input) -> Answer
 {
-    const Grid<std::string::value_type> grid(
-	input,
-	[](auto, auto, char arg3) -> char {return arg3;}
-	);
+    // Read-only: the input is the grid
+    const GridView<const char> grid = text_grid(input);
 
     Answer counter = 0;
 
@@ -94,7 +101,8 @@ auto part_1(const std::string& input) -> Answer
     return counter;
 }
 
-auto try_remove_roll(Grid<char>& grid, size_t i, size_t j) -> Answer { // NOLINT
+template <typename G>
+constexpr auto try_remove_roll(G& grid, size_t i, size_t j) -> Answer { // NOLINT
     if (grid.at(i, j) != PAPER_SYMBOL) {
 	return 0;
     }
@@ -115,10 +123,52 @@ auto try_remove_roll(Grid<char>& grid, size_t i, size_t j) -> Answer { // NOLINT
     return counter;
 }
 
-auto part_2(const std::string& input) -> Answer
+constexpr uint8_t CROWDED = 4; // Neighbours that keep a roll in place
+
+// One pass over the grid, a row of neighbour counts at a time from the
+// dispatched kernel into counts, ncols long. With cells, the buffer the
+// grid views, accessible
+// rolls are also removed as they are found: counts made before a
+// neighbour went can only be too high, so every roll taken is accessible,
+// and a pass that takes none saw the exact counts.
+auto sweep(const GridView<const char>& grid, std::span<uint8_t> counts, char *cells = nullptr) -> Answer
+{
+    const auto line = [&](size_t i) -> std::string_view {
+	if (i >= grid.nrows) {
+	    return {};
+	}
+	const std::span<const char> row = grid.row(i);
+	return {row.data(), row.size()};
+    };
+
+    Answer accessible = 0;
+    for (size_t i = 0; i < grid.nrows; i++) {
+	const std::string_view row = line(i);
+	count_neighbours(i > 0 ? line(i - 1) : std::string_view(), row, line(i + 1), PAPER_SYMBOL, counts);
+	for (size_t j = 0; j < grid.ncols; j++) {
+	    if (row[j] == PAPER_SYMBOL && counts[j] < CROWDED) {
+		accessible++;
+		if (cells != nullptr) {
+		    cells[grid.idx(i, j)] = EMPTY_SYMBOL; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+	    }
+	}
+    }
+    return accessible;
+}
+
+auto part_1(const std::string& input) -> Answer
+{
+    const GridView<const char> grid = text_grid(input);
+    std::pmr::vector<uint8_t> counts(grid.ncols, scratch_memory());
+    return sweep(grid, counts);
+}
+
+template <typename Layout = RowMajor>
+constexpr auto solve_2(std::string_view input) -> Answer
 {
-    Grid<std::string::value_type> grid(
-	input,
+    Grid<std::string::value_type, Layout> grid(
+	text_grid(input),
 	[](auto, auto, char arg3) -> char {return arg3;}
 	);
 
@@ -138,19 +188,46 @@ auto part_2(const std::string& input) -> Answer
     return counter;
 }
 
+auto part_2(const std::string& input) -> Answer
+{
+    std::pmr::string cells(input, scratch_memory());
+    const GridView<const char> grid = text_grid(cells);
+    std::pmr::vector<uint8_t> counts(grid.ncols, scratch_memory());
+    Answer removed = 0;
+    for (Answer update = 1; update != 0; removed += update) {
+	update = sweep(grid, counts, cells.data());
+    }
+    return removed;
+}
+
+constexpr std::string_view EXAMPLE =
+    "..@@.@@@@.\n"
+    "@@@.@.@.@@\n"
+    "@@@@@.@.@@\n"
+    "@.@@@@..@.\n"
+    "@@.@@@@.@@\n"
+    ".@@@@@@@.@\n"
+    ".@.@.@.@@@\n"
+    "@.@@@.@@@@\n"
+    ".@@@@@@@@.\n"
+    "@.@.@@@.@.\n";
+
+static_assert(solve_1(EXAMPLE) == 13);
+static_assert(solve_2(EXAMPLE) == 43);
+static_assert(solve_2<Tiled<4>>(EXAMPLE) == 43);
+static_assert(solve_2<Morton>(EXAMPLE) == 43);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute(solve_1, embedded_file("inputs/day4.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute(solve_2<>, embedded_file("inputs/day4.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
+}
+
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
-    const std::string test_input =
-	"..@@.@@@@.\n"
-	"@@@.@.@.@@\n"
-	"@@@@@.@.@@\n"
-	"@.@@@@..@.\n"
-	"@@.@@@@.@@\n"
-	".@@@@@@@.@\n"
-	".@.@.@.@@@\n"
-	"@.@@@.@@@@\n"
-	".@@@@@@@@.\n"
-	"@.@.@@@.@.\n";
+    const std::string test_input(EXAMPLE);
 
     const Grid<std::string::value_type> grid(
 	test_input,
@@ -165,6 +242,105 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     CHECK(part_2(test_input) == 43);
 
+    // The view indexes the input in place, newlines included in the stride
+    const GridView<const char> view = text_grid(test_input);
+    CHECK(view.nrows == 10 && view.ncols == 10 && view.stride == 11); // NOLINT(readability-simplify-boolean-expr)
+    CHECK(&view.at(1, 0) == &test_input[11]);
+    CHECK(is_accessible_roll(view, 0, 2));
+
+    // Rectangular but not square; rows split over several threads
+    const std::string wide_input = "@@.@.\n.@@..\n@....\n..@@@\n";
+    const GridView<const char> wide_view = text_grid(wide_input);
+    const Grid<int> wide_grid(wide_view, [](auto, auto, char chr) -> int { return chr == PAPER_SYMBOL ? 1 : 0; }, 2);
+    CHECK(wide_grid.nrows == 4 && wide_grid.ncols == 5); // NOLINT(readability-simplify-boolean-expr)
+    for (size_t i = 0; i < wide_grid.nrows; i++) {
+	for (size_t j = 0; j < wide_grid.ncols; j++) {
+	    CHECK(wide_grid.at(i, j) == (wide_view.at(i, j) == PAPER_SYMBOL ? 1 : 0));
+	}
+    }
+
+    // Every layout maps the cells one-to-one into its storage
+    const auto one_to_one = [](const auto& layout) -> bool {
+	std::vector<bool> used(layout.size());
+	for (size_t i = 0; i < layout.nrows; i++) {
+	    for (size_t j = 0; j < layout.ncols; j++) {
+		const size_t idx = layout.index(i, j);
+		if (idx >= used.size() || used[idx]) {
+		    return false;
+		}
+		used[idx] = true;
+	    }
+	}
+	return true;
+    };
+    for (const auto& [nrows, ncols] : {std::pair<size_t, size_t>{1, 1}, {5, 7}, {9, 3}, {64, 64}, {65, 130}}) {
+	CHECK(one_to_one(RowMajor(nrows, ncols)));
+	CHECK(one_to_one(Tiled<8>(nrows, ncols)));
+	CHECK(one_to_one(Morton(nrows, ncols)));
+    }
+    const Grid<int, Morton> wide_morton(wide_view, [](auto, auto, char chr) -> int { return chr == PAPER_SYMBOL ? 1 : 0; });
+    const Grid<int, Tiled<2>> wide_tiled(wide_view, [](auto, auto, char chr) -> int { return chr == PAPER_SYMBOL ? 1 : 0; }, 2);
+    for (size_t i = 0; i < wide_grid.nrows; i++) {
+	for (size_t j = 0; j < wide_grid.ncols; j++) {
+	    CHECK(wide_morton.at(i, j) == wide_grid.at(i, j));
+	    CHECK(wide_tiled.at(i, j) == wide_grid.at(i, j));
+	}
+    }
+    CHECK(solve_2<Tiled<>>(wide_input) == solve_2(wide_input));
+
+    // Every kernel variant this CPU runs, on rows wider than their vectors
+    std::string large_input;
+    for (size_t i = 0; i < 40; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	for (size_t j = 0; j < 203; j++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    large_input += ((i * 31) + (j * 17) + (i * j)) % 7 < 5 ? PAPER_SYMBOL : EMPTY_SYMBOL; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	}
+	large_input += '\n';
+    }
+    for (const Isa variant : ISAS) {
+	if (!isa_supported(variant)) {
+	    continue;
+	}
+	const ScopedIsa forced(variant);
+	CHECK(part_1(test_input) == 13);
+	CHECK(part_2(test_input) == 43);
+	CHECK(part_1(large_input) == solve_1(large_input));
+	CHECK(part_2(large_input) == solve_2(large_input));
+	CHECK(part_1(wide_input) == solve_1(wide_input));
+    }
+
+    // Scratch taken from an arena, as batch workers do: once rewound, the
+    // next inputs reuse its memory instead of growing it
+    {
+	std::string tall_input;
+	for (size_t i = 0; i < 30; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    tall_input += large_input;
+	}
+	const Answer tall_1 = part_1(tall_input);
+	const Answer tall_2 = part_2(tall_input);
+	ScratchArena arena;
+	const ScopedScratch scratch(arena);
+	CHECK(scratch_memory() == &arena);
+	CHECK(part_2(tall_input) == tall_2);
+	CHECK(arena.capacity() >= tall_input.size());
+	arena.rewind();
+	const size_t capacity = arena.capacity();
+	for (size_t round = 0; round < 3; round++) {
+	    CHECK(part_1(tall_input) == tall_1);
+	    CHECK(part_2(tall_input) == tall_2);
+	    arena.rewind();
+	}
+	CHECK(arena.capacity() == capacity);
+    }
+    CHECK(scratch_memory() == std::pmr::get_default_resource());
+
+    bool ragged = false;
+    try {
+	UNUSED(text_grid("@@.\n@.\n@@.\n"));
+    } catch (std::runtime_error&) {
+	ragged = true;
+    }
+    CHECK(ragged);
+
 
     
 }
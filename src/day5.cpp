@@ -1,43 +1,57 @@
 #include <algorithm>
 #include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
 #include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <numeric>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "commands.hpp"
 #include "common.hpp"
+#include "parallel.hpp"
+#include "pipeline.hpp"
 
 namespace day5 {
 
-auto parse_input(const std::string& input)
-    -> std::pair<std::vector<std::pair<size_t, size_t>>,
-		 std::vector<size_t>> {
-    std::vector<std::string> lines = split_at(input, '\n', true);
+auto version() -> std::string_view { return SOURCE_HASH; }
 
+using Model = std::pair<std::vector<std::pair<size_t, size_t>>, std::vector<size_t>>;
+
+// Ranges up to the first blank line, then ingredient ids
+constexpr auto parse_input(std::string_view input) -> Model {
     std::vector<std::pair<size_t, size_t>> ranges;
     std::vector<size_t> ingredients;
-    
-    std::vector<std::string>::size_type i = 0; // NOLINT(readability-identifier-length)
-    for (; i < lines.size(); i++) {
-	if (lines.at(i).empty()) {
-	    i++;
-	    break;
-	}
-	const std::vector<std::string> fields = split_at(lines.at(i), '-');
-	ranges.emplace_back(std::stoull(fields.at(0)), std::stoull(fields.at(1)));
-    }
-    
-    for (; i < lines.size(); i++) {
-	ingredients.push_back(std::stoull(lines.at(i)));
+
+    size_t blank = input.find("\n\n");
+    if (blank == std::string_view::npos) {
+	blank = input.size();
     }
 
+    for_each_line(input.substr(0, blank), [&](std::string_view line) -> void {
+	const size_t dash = line.find('-');
+	CHECK(dash != std::string_view::npos);
+	ranges.emplace_back(parse_integer(line.substr(0, dash)), parse_integer(line.substr(dash + 1)));
+    });
+
+    for_each_line(input.substr(std::min(blank + 2, input.size())), [&](std::string_view line) -> void {
+	ingredients.push_back(parse_integer(line));
+    });
+
     std::ranges::for_each(ranges, [](const auto& pair)->void{CHECK(pair.first <= pair.second);});
 
     return std::make_pair(ranges, ingredients);
 }
 
-auto is_fresh(size_t ingredient_id,
+constexpr auto is_fresh(size_t ingredient_id,
 	      const std::vector<std::pair<size_t, size_t>>& ranges) -> bool {
     return std::ranges::any_of(
 	ranges,
@@ -47,9 +61,48 @@ auto is_fresh(size_t ingredient_id,
 	});
 }
 
-auto part_1(const std::string& input) -> Answer
+// Snapshot arrays: range starts, range ends, ingredient ids
+auto encode_input(const Model& model, ModelWriter& writer) -> void
+{
+    const auto& [ranges, ingredients] = model;
+    std::vector<size_t> starts;
+    std::vector<size_t> ends;
+    for (const auto& [start, end] : ranges) {
+	starts.push_back(start);
+	ends.push_back(end);
+    }
+    writer.add(starts);
+    writer.add(ends);
+    writer.add(ingredients);
+}
+
+auto decode_input(const ModelSnapshot& snapshot) -> std::optional<Model>
 {
-    auto [ranges, ingredients] = parse_input(input);
+    if (snapshot.size() != 3) {
+	return {};
+    }
+    const std::vector<size_t> starts = snapshot.array<size_t>(0);
+    const std::vector<size_t> ends = snapshot.array<size_t>(1);
+    if (starts.size() != ends.size()) {
+	return {};
+    }
+    Model model;
+    for (size_t i = 0; i < starts.size(); i++) {
+	model.first.emplace_back(starts[i], ends[i]);
+    }
+    model.second = snapshot.array<size_t>(2);
+    return model;
+}
+
+// Both parts share the parsed model
+auto load_input(std::string_view input) -> Model
+{
+    return cached_parse({5, 0, version(), 0}, input, parse_input, encode_input, decode_input);
+}
+
+constexpr auto count_fresh(const Model& model) -> Answer
+{
+    const auto& [ranges, ingredients] = model;
     return std::ranges::count_if(
 	ingredients,
 	[&] (size_t iid) -> bool {
@@ -57,17 +110,22 @@ auto part_1(const std::string& input) -> Answer
 	});
 }
 
-auto ranges_overlap(const std::pair<size_t, size_t>& lhs,
+constexpr auto solve_1(std::string_view input) -> Answer
+{
+    return count_fresh(parse_input(input));
+}
+
+
+constexpr auto ranges_overlap(const std::pair<size_t, size_t>& lhs,
 		    const std::pair<size_t, size_t>& rhs) -> bool {
     return rhs.first <= lhs.second;
 }
 
-auto deoverlap(std::vector<std::pair<size_t, size_t>>& ranges) -> void { 
-
+// Merge overlapping ranges of a sorted list
+constexpr auto merge_sorted(std::vector<std::pair<size_t, size_t>>& ranges) -> void {
     if (ranges.size() <= 1) {
 	return;
     }
-    std::ranges::sort(ranges);
     auto iter = ranges.begin();
     // cppcheck-suppress invalidContainer
     while (iter < ranges.end() - 1) {
@@ -79,34 +137,201 @@ auto deoverlap(std::vector<std::pair<size_t, size_t>>& ranges) -> void {
 	    iter = std::next(iter);
 	}
     }
-    
+}
+
+constexpr auto deoverlap(std::vector<std::pair<size_t, size_t>>& ranges) -> void {
+    std::ranges::sort(ranges);
+    merge_sorted(ranges);
+}
+
+// Whether a sorted, merged list of ranges holds the id: the first range
+// starting after it is found, and the one before it may hold it
+constexpr auto in_merged(size_t iid, const std::vector<std::pair<size_t, size_t>>& ranges) -> bool {
+    const auto next = std::ranges::upper_bound(ranges, iid, {}, &std::pair<size_t, size_t>::first);
+    return next != ranges.begin() && iid <= std::prev(next)->second;
+}
+
+constexpr size_t INGREDIENT_GRAIN = 1024;
+
+auto parallel_merge(std::vector<std::pair<size_t, size_t>>& ranges) -> void {
+    parallel_sort(ranges);
+    merge_sorted(ranges);
+}
+
+// Ranges are merged once so that every lookup is a binary search, run
+// over several ids at once by the dispatched kernel
+auto part_1(const std::string& input) -> Answer
+{
+    auto [ranges, ingredients] = load_input(input);
+    parallel_merge(ranges);
+    std::pmr::vector<size_t> starts(scratch_memory());
+    std::pmr::vector<size_t> ends(scratch_memory());
+    starts.reserve(ranges.size());
+    ends.reserve(ranges.size());
+    for (const auto& [start, end] : ranges) {
+	starts.push_back(start);
+	ends.push_back(end);
+    }
+    const std::span<const size_t> ids(ingredients);
+    return parallel_reduce(ids.size(), Answer{0}, [&](size_t first, size_t last) -> Answer {
+	return static_cast<Answer>(count_in_ranges(starts, ends, ids.subspan(first, last - first)));
+    }, std::plus<>(), INGREDIENT_GRAIN);
 }
     
-auto part_2(const std::string& input) -> Answer
+constexpr auto count_all_fresh(Model model) -> Answer
 {
-    auto [ranges, ingredients] = parse_input(input);
-    UNUSED(ingredients);
+    auto& ranges = model.first;
     deoverlap(ranges);
-    return std::accumulate(ranges.begin(), ranges.end(), 0LL,
+    return std::accumulate(ranges.begin(), ranges.end(), Answer{0},
+			   [](Answer acc, const auto& rng) -> Answer {
+			       return acc + rng.second - rng.first + 1;
+			   });
+}
+
+constexpr auto solve_2(std::string_view input) -> Answer
+{
+    return count_all_fresh(parse_input(input));
+}
+
+auto part_2(const std::string& input) -> Answer
+{
+    auto ranges = load_input(input).first;
+    parallel_merge(ranges);
+    return std::accumulate(ranges.begin(), ranges.end(), Answer{0},
 			   [](Answer acc, const auto& rng) -> Answer {
 			       return acc + rng.second - rng.first + 1;
 			   });
 }
 
+// Streaming ingredient check: the ranges are kept, merged once the
+// first ingredient arrives, and every ingredient is looked up and
+// dropped. Memory follows the number of ranges, not of ingredients.
+class FreshCounter {
+public:
+    explicit FreshCounter(bool all_ids) : m_all_ids{all_ids} {}
+
+    void add_range(size_t start, size_t end) {
+	m_ranges.emplace_back(start, end);
+	m_merged = false;
+    }
+    void add_ingredient(size_t iid) {
+	merge();
+	if (in_merged(iid, m_ranges)) {
+	    m_count++;
+	}
+    }
+    Answer result() {
+	merge();
+	if (m_all_ids) {
+	    for (const auto& [start, end] : m_ranges) {
+		m_count += static_cast<Answer>(end - start + 1);
+	    }
+	}
+	return m_count;
+    }
+
+private:
+    void merge() {
+	if (!m_merged) {
+	    deoverlap(m_ranges);
+	    m_merged = true;
+	}
+    }
+
+    bool m_all_ids;
+    bool m_merged{false};
+    std::vector<std::pair<size_t, size_t>> m_ranges;
+    Answer m_count{0};
+};
+
+// A range before the blank line, an ingredient id after it
+struct Entry {
+    size_t first;
+    size_t last;
+    bool ingredient;
+};
+
+// Lines are parsed as the chunks arrive, while the worker merges the
+// ranges and looks up the ingredients already parsed
+class FreshSolver : public StreamSolver {
+public:
+    explicit FreshSolver(bool all_ids) : m_all_ids{all_ids}, m_counter{all_ids} {}
+
+    void consume(std::string_view chunk) override {
+	m_reader.consume(chunk, [this](std::string_view line) -> void { on_line(line); });
+    }
+    Answer finish() override {
+	m_reader.finish([this](std::string_view line) -> void { on_line(line); });
+	m_entries.finish();
+	return m_counter.result();
+    }
+
+private:
+    void on_line(std::string_view line) {
+	if (line.empty()) {
+	    m_past_blank = true;
+	    return;
+	}
+	if (!m_past_blank) {
+	    const size_t dash = line.find('-');
+	    CHECK(dash != std::string_view::npos);
+	    const auto start = static_cast<size_t>(parse_integer(line.substr(0, dash)));
+	    const auto end = static_cast<size_t>(parse_integer(line.substr(dash + 1)));
+	    CHECK(start <= end);
+	    m_entries.push({start, end, false});
+	} else if (!m_all_ids) {
+	    const auto iid = static_cast<size_t>(parse_integer(line));
+	    m_entries.push({iid, iid, true});
+	}
+    }
+
+    bool m_all_ids;
+    bool m_past_blank{false};
+    LineReader m_reader;
+    FreshCounter m_counter;
+    Pipeline<Entry> m_entries{[this](std::span<const Entry> entries) -> void {
+	for (const Entry& entry : entries) {
+	    if (entry.ingredient) {
+		m_counter.add_ingredient(entry.first);
+	    } else {
+		m_counter.add_range(entry.first, entry.last);
+	    }
+	}
+    }};
+};
+
+auto stream_solver(int part) -> std::unique_ptr<StreamSolver>
+{
+    return std::make_unique<FreshSolver>(part == 2);
+}
+
+constexpr std::string_view EXAMPLE =
+    "3-5\n"
+    "10-14\n"
+    "16-20\n"
+    "12-18\n"
+    "\n"
+    "1\n"
+    "5\n"
+    "8\n"
+    "11\n"
+    "17\n"
+    "32\n";
+
+static_assert(solve_1(EXAMPLE) == 3);
+static_assert(solve_2(EXAMPLE) == 14);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute(solve_1, embedded_file("inputs/day5.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute(solve_2, embedded_file("inputs/day5.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
+}
+
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
-    const std::string test_input = 
-	"3-5\n"
-	"10-14\n"
-	"16-20\n"
-	"12-18\n"
-	"\n"
-	"1\n"
-	"5\n"
-	"8\n"
-	"11\n"
-	"17\n"
-	"32\n";
+    const std::string test_input(EXAMPLE);
 
     auto [ranges, ingredients] = parse_input(test_input);
     CHECK(ranges.size() == 4);
@@ -139,6 +364,111 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
     
     CHECK(part_2(test_input) == 14);
 
+    const CacheKey key{5, 0, version(), hash_bytes(test_input)};
+    ModelWriter writer;
+    encode_input(parse_input(test_input), writer);
+    const std::string encoded = writer.encode(key);
+    const std::span<const std::byte> bytes = std::as_bytes(std::span(encoded));
+    const std::optional<ModelSnapshot> snapshot = ModelSnapshot::decode(nullptr, bytes, key);
+    CHECK(snapshot && decode_input(*snapshot) == parse_input(test_input));
+    CHECK(!ModelSnapshot::decode(nullptr, bytes, {5, 1, version(), key.input}));
+    CHECK(!ModelSnapshot::decode(nullptr, bytes, {5, 0, "other", key.input}));
+    CHECK(!ModelSnapshot::decode(nullptr, bytes.first(bytes.size() - 8), key)); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    std::string damaged = encoded;
+    damaged.back() ^= 1;
+    CHECK(!ModelSnapshot::decode(nullptr, std::as_bytes(std::span(damaged)), key));
+
+    // xxHash64 reference vectors, down every tail of the hash
+    CHECK(hash_bytes("") == 0xEF46DB3751D8E999ULL); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    CHECK(hash_bytes("a") == 0xD24EC4F1A98C6E5BULL); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    CHECK(hash_bytes("abc") == 0x44BC2CF5AD770999ULL); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    CHECK(hash_bytes("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ULL); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    CHECK(hash_bytes("The quick brown fox jumps over the lazy dog, then the quick brown fox jumps"
+		     " over the lazy dog again and again!!") == 0x9C38C9452DEE73DAULL); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+
+    {
+	const ScratchDir scratch(true);
+	const CacheKey old_key{5, 1, "old", 0xABC}; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	cache_store(old_key, 12, true); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	cache_store({5, 2, "old", old_key.input}, 34, false); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	std::stringstream old_name;
+	old_name << "day5-1-" << std::hex << std::setfill('0') << std::setw(16) << hash_bytes("old") << "-0000000000000abc"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(std::filesystem::is_regular_file(scratch.path() / old_name.str()));
+
+	const std::optional<CachedAnswer> verified = cache_lookup(old_key);
+	CHECK(verified && verified->answer == 12 && verified->verified); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	const std::optional<CachedAnswer> unverified = cache_lookup({5, 2, "old", old_key.input});
+	CHECK(unverified && unverified->answer == 34 && !unverified->verified); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+
+	// A new version of part 1 prunes the old one, and only that
+	cache_store({5, 1, "new", old_key.input}, 56, true); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(!cache_lookup(old_key));
+	CHECK(cache_lookup({5, 1, "new", old_key.input}).value().answer == 56); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(cache_lookup({5, 2, "old", old_key.input}));
+	CHECK(std::distance(std::filesystem::directory_iterator(scratch.path()), std::filesystem::directory_iterator()) == 2);
+    }
+
+    // Same answers whatever the number of threads, on enough ingredients
+    // for several chunks but under the snapshot cache threshold
+    std::string large_input;
+    size_t state = 1;
+    const auto next_random = [&](size_t bound) -> size_t {
+	state = (state * 6364136223846793005ULL) + 1442695040888963407ULL; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	return (state >> 33U) % bound; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    };
+    for (size_t i = 0; i < 1500; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	const size_t start = next_random(1000000); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	large_input += std::to_string(start) + "-" + std::to_string(start + next_random(100)) + "\n"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    large_input += "\n";
+    for (size_t i = 0; i < 4000; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	large_input += std::to_string(next_random(1100000)) + "\n"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    Answer large_1 = 0;
+    Answer large_2 = 0;
+    {
+	const ScopedThreads single(1);
+	large_1 = part_1(large_input);
+	large_2 = part_2(large_input);
+    }
+    for (const size_t n_threads : {2, 7}) {
+	const ScopedThreads scoped(n_threads);
+	CHECK(part_1(large_input) == large_1);
+	CHECK(part_2(large_input) == large_2);
+    }
+    for (const Isa variant : ISAS) {
+	if (isa_supported(variant)) {
+	    const ScopedIsa forced(variant);
+	    CHECK(part_1(large_input) == large_1);
+	    CHECK(part_1(test_input) == 3);
+	}
+    }
+    CHECK(large_input.size() < MODEL_CACHE_MIN_BYTES);
+    std::istringstream large_stream_1(large_input);
+    CHECK(solve_stream(large_stream_1, *stream_solver(1)) == large_1);
+    std::istringstream large_stream_2(large_input);
+    CHECK(solve_stream(large_stream_2, *stream_solver(2)) == large_2);
+
+    std::vector<size_t> shuffled(large_input.size());
+    for (size_t& value : shuffled) {
+	value = next_random(1000); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    }
+    std::vector<size_t> sorted = shuffled;
+    std::ranges::sort(sorted);
+    for (const size_t n_threads : {1, 3, 8}) {
+	const ScopedThreads scoped(n_threads);
+	std::vector<size_t> values = shuffled;
+	parallel_sort(values, std::less<>(), 100); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	CHECK(values == sorted);
+    }
+
+    for (const size_t chunk : {1, 4, 9, 64}) {
+	std::istringstream stream_1(test_input);
+	CHECK(solve_stream(stream_1, *stream_solver(1), chunk) == 3);
+	std::istringstream stream_2(test_input);
+	CHECK(solve_stream(stream_2, *stream_solver(2), chunk) == 14);
+    }
+
     // 334572241531681 too low
     // 320578958725143
     // 334572241531681
@@ -1,172 +1,669 @@
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <functional>
+#include <istream>
 #include <iterator>
+#include <memory>
 #include <numeric>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <streambuf>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 
+#include "commands.hpp"
 #include "common.hpp"
+#include "parallel.hpp"
 
 namespace day6 {
 
-struct Problem {
-    using Operation = std::variant<std::plus<Answer>, std::minus<Answer>, std::multiplies<Answer>>;
-    std::vector<Answer> numbers; // NOLINT(misc-non-private-member-variables-in-classes)
-    Operation operation; // NOLINT(misc-non-private-member-variables-in-classes)
-    explicit Problem(Operation opr) : operation{opr} {}
+auto version() -> std::string_view { return SOURCE_HASH; }
 
-    [[nodiscard]]
-    auto answer() const -> Answer {
-	return std::visit([&](const auto& opr) -> Answer {
-	    return std::accumulate(std::next(numbers.begin()), numbers.end(), numbers.front(), opr);
-	}, operation);
-    }
-    
+enum class Operation : uint8_t { plus, minus, multiplies };
+constexpr size_t N_OPERATIONS = 3;
+
+// Problems sharing an operation, stored operand-major: row k holds the
+// k-th operand of every problem in the batch, so that reductions run
+// lane-parallel across problems.
+struct Batch {
+    std::vector<size_t> problems; // Index of each problem in the worksheet
+    std::vector<Answer> numbers;
+};
+
+struct Worksheet {
+    size_t depth{0};
+    std::vector<Operation> operations;
+    std::vector<size_t> slots; // Position of each problem within its batch
+    std::array<Batch, N_OPERATIONS> batches;
+
+    constexpr Worksheet(std::vector<Operation> ops, size_t n_operands);
+
+    [[nodiscard]] constexpr auto size() const -> size_t { return operations.size(); }
+    [[nodiscard]] constexpr auto batch(size_t prob) const -> const Batch&;
+    constexpr auto number(size_t prob, size_t operand) -> Answer&;
+    [[nodiscard]] constexpr auto number(size_t prob, size_t operand) const -> Answer;
+
+    template <bool CHECK_OVERFLOW = false>
+    [[nodiscard]] constexpr auto answers() const -> std::vector<Answer>;
+
+    template <bool CHECK_OVERFLOW = false>
+    [[nodiscard]] constexpr auto total() const -> Answer;
+
+private:
+    template <bool CHECK_OVERFLOW, typename F>
+    constexpr auto evaluate(F f) const -> void;
 };
 
-auto parse_input(const std::string& input) -> std::vector<Problem> {
-    std::vector<Problem> problems;
+constexpr auto parse_operation(std::string_view opstr) -> Operation {
+    if (opstr.size() != 1) {
+	throw std::invalid_argument("Invalid opstr: " + std::string(opstr));
+    }
+    switch (opstr[0]) {
+    case '+': return Operation::plus;
+    case '-': return Operation::minus;
+    case '*': return Operation::multiplies;
+    default:
+	throw std::invalid_argument("Invalid opstr: " + std::string(opstr));
+    }
+}
+
+// Call f on every space-separated field of the line
+template <typename F>
+constexpr auto for_each_field(std::string_view line, F f) -> void {
+    size_t start = line.find_first_not_of(' ');
+    while (start != std::string_view::npos) {
+	const size_t end = std::min(line.find(' ', start), line.size());
+	f(line.substr(start, end - start));
+	start = line.find_first_not_of(' ', end);
+    }
+}
+
+constexpr auto parse_operations(std::string_view line) -> std::vector<Operation> {
+    std::vector<Operation> ops;
+    for_each_field(line, [&](std::string_view field) -> void { ops.push_back(parse_operation(field)); });
+    return ops;
+}
+
+// Padding operands leave the result unchanged
+constexpr auto identity(Operation opr) -> Answer {
+    return opr == Operation::multiplies ? 1 : 0;
+}
+
+constexpr Worksheet::Worksheet(std::vector<Operation> ops, size_t n_operands)
+    : depth{n_operands}, operations{std::move(ops)}, slots(operations.size())
+{
+    CHECK(depth >= 1);
+    for (size_t prob = 0; prob < operations.size(); prob++) {
+	Batch& bat = batches.at(static_cast<size_t>(operations[prob]));
+	slots[prob] = bat.problems.size();
+	bat.problems.push_back(prob);
+    }
+    for (size_t iop = 0; iop < N_OPERATIONS; iop++) {
+	Batch& bat = batches.at(iop);
+	bat.numbers.assign(depth * bat.problems.size(), identity(static_cast<Operation>(iop)));
+    }
+}
+
+constexpr auto Worksheet::batch(size_t prob) const -> const Batch& {
+    return batches.at(static_cast<size_t>(operations.at(prob)));
+}
+
+constexpr auto Worksheet::number(size_t prob, size_t operand) -> Answer& {
+    CHECK(operand < depth);
+    Batch& bat = batches.at(static_cast<size_t>(operations.at(prob)));
+    return bat.numbers.at((operand * bat.problems.size()) + slots[prob]);
+}
+
+constexpr auto Worksheet::number(size_t prob, size_t operand) const -> Answer {
+    CHECK(operand < depth);
+    const Batch& bat = batch(prob);
+    return bat.numbers.at((operand * bat.problems.size()) + slots[prob]);
+}
+
+template <Operation OP, bool CHECK_OVERFLOW>
+constexpr auto combine(Answer lhs, Answer rhs, bool& overflow) -> Answer {
+    Answer res{0};
+    if constexpr (CHECK_OVERFLOW) {
+	if constexpr (OP == Operation::plus) {
+	    overflow |= __builtin_add_overflow(lhs, rhs, &res);
+	} else if constexpr (OP == Operation::minus) {
+	    overflow |= __builtin_sub_overflow(lhs, rhs, &res);
+	} else {
+	    overflow |= __builtin_mul_overflow(lhs, rhs, &res);
+	}
+    } else {
+	UNUSED(overflow);
+	if constexpr (OP == Operation::plus) {
+	    res = lhs + rhs;
+	} else if constexpr (OP == Operation::minus) {
+	    res = lhs - rhs;
+	} else {
+	    res = lhs * rhs;
+	}
+    }
+    return res;
+}
+
+// Fold the operand rows of a batch into acc, one lane per problem of
+// [first, last). The operation is fixed at compile time so the inner loop
+// has no dispatch.
+template <Operation OP, bool CHECK_OVERFLOW>
+constexpr auto reduce(const Batch& bat, size_t depth, std::vector<Answer>& acc, size_t first, size_t last) -> bool {
+    const size_t width = bat.problems.size();
+    const Answer* numbers = std::next(bat.numbers.data(), static_cast<std::ptrdiff_t>(first));
+    acc.assign(numbers, std::next(numbers, static_cast<std::ptrdiff_t>(last - first)));
+    bool overflow = false;
+    for (size_t operand = 1; operand < depth; operand++) {
+	const Answer* row = std::next(numbers, static_cast<std::ptrdiff_t>(operand * width));
+	for (size_t lane = 0; lane < acc.size(); lane++) {
+	    acc[lane] = combine<OP, CHECK_OVERFLOW>(acc[lane], row[lane], overflow); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+    }
+    return overflow;
+}
+
+template <Operation OP, bool CHECK_OVERFLOW>
+constexpr auto reduce(const Batch& bat, size_t depth, std::vector<Answer>& acc) -> bool {
+    return reduce<OP, CHECK_OVERFLOW>(bat, depth, acc, 0, bat.problems.size());
+}
+
+template <bool CHECK_OVERFLOW, typename F>
+constexpr auto Worksheet::evaluate(F f) const -> void {
+    std::vector<Answer> acc;
+    bool overflow = false;
+    overflow |= reduce<Operation::plus, CHECK_OVERFLOW>(batches[0], depth, acc);
+    f(batches[0], acc);
+    overflow |= reduce<Operation::minus, CHECK_OVERFLOW>(batches[1], depth, acc);
+    f(batches[1], acc);
+    overflow |= reduce<Operation::multiplies, CHECK_OVERFLOW>(batches[2], depth, acc);
+    f(batches[2], acc);
+    if (overflow) {
+	throw std::overflow_error("Overflow while evaluating worksheet");
+    }
+}
+
+template <bool CHECK_OVERFLOW>
+constexpr auto Worksheet::answers() const -> std::vector<Answer> {
+    std::vector<Answer> result(size());
+    evaluate<CHECK_OVERFLOW>([&](const Batch& bat, const std::vector<Answer>& acc) -> void {
+	for (size_t lane = 0; lane < acc.size(); lane++) {
+	    result[bat.problems[lane]] = acc[lane];
+	}
+    });
+    return result;
+}
+
+template <bool CHECK_OVERFLOW>
+constexpr auto Worksheet::total() const -> Answer {
+    Answer sum = 0;
+    bool overflow = false;
+    evaluate<CHECK_OVERFLOW>([&](const Batch&, const std::vector<Answer>& acc) -> void {
+	sum = std::accumulate(acc.begin(), acc.end(), sum, [&](Answer lhs, Answer rhs) -> Answer {
+	    return combine<Operation::plus, CHECK_OVERFLOW>(lhs, rhs, overflow);
+	});
+    });
+    if (overflow) {
+	throw std::overflow_error("Overflow while summing worksheet");
+    }
+    return sum;
+}
+
+constexpr size_t LANE_GRAIN = 1024;
+
+// Sum of the answers of every problem of a batch, lanes split across
+// threads; each chunk folds its own slice of every operand row.
+template <Operation OP>
+auto parallel_batch_total(const Batch& bat, size_t depth) -> Answer {
+    return parallel_reduce(bat.problems.size(), Answer{0}, [&](size_t first, size_t last) -> Answer {
+	std::vector<Answer> acc;
+	reduce<OP, false>(bat, depth, acc, first, last);
+	return std::accumulate(acc.begin(), acc.end(), Answer{0});
+    }, std::plus<>(), LANE_GRAIN);
+}
+
+auto parallel_total(const Worksheet& sheet) -> Answer {
+    return parallel_batch_total<Operation::plus>(sheet.batches[0], sheet.depth)
+	+ parallel_batch_total<Operation::minus>(sheet.batches[1], sheet.depth)
+	+ parallel_batch_total<Operation::multiplies>(sheet.batches[2], sheet.depth);
+}
 
-    std::vector<std::string> lines = split_lines(input);
-    CHECK(input.size() >= 2);
+constexpr auto row_views(std::string_view input) -> std::vector<std::string_view> {
+    std::vector<std::string_view> rows;
+    for_each_line(input, [&](std::string_view row) -> void { rows.push_back(row); });
+    return rows;
+}
+
+constexpr auto parse_input(std::string_view input) -> Worksheet {
+    const std::vector<std::string_view> lines = row_views(input);
+    CHECK(lines.size() >= 2);
 
     // Do operations firsts
-    std::ranges::transform(split_at(lines.back(), ' '), std::back_inserter(problems),
-			   [] (const std::string& opstr) -> Problem {
-			       if (opstr.size() != 1) {
-				   throw std::invalid_argument("Invalid opstr: " + opstr);
-			       }
-			       switch (opstr[0]) {
-			       case '+': return Problem(std::plus<Answer>{});
-			       case '-': return Problem(std::minus<Answer>{});
-			       case '*': return Problem(std::multiplies<Answer>{});
-			       default:
-				   throw std::invalid_argument("Invalid opstr: " + opstr);
-			       }
-			   });
-
-    std::ranges::for_each(lines.begin(), std::prev(lines.end()),
-			  [&] (const std::string& line) -> void {
-			      std::vector<std::string> elems = split_at(line, ' ');
-			      for (size_t idx = 0; idx < elems.size(); idx++) {
-				  problems.at(idx).numbers.push_back(std::stoll(elems.at(idx)));
-			      }
-			  });
-
-    return problems;
+    Worksheet sheet(parse_operations(lines.back()), lines.size() - 1);
+
+    for (size_t operand = 0; operand < sheet.depth; operand++) {
+	size_t idx = 0;
+	for_each_field(lines.at(operand), [&](std::string_view elem) -> void {
+	    CHECK(idx < sheet.size());
+	    sheet.number(idx++, operand) = parse_integer(elem);
+	});
+	CHECK(idx == sheet.size());
+    }
+
+    return sheet;
 
 }
 
+// Snapshot arrays: depth, operations, then the numbers of every batch.
+// The batch layout follows from the operations alone.
+auto encode_sheet(const Worksheet& sheet, ModelWriter& writer) -> void
+{
+    writer.add(std::vector<size_t>{sheet.depth});
+    writer.add(sheet.operations);
+    for (const Batch& bat : sheet.batches) {
+	writer.add(bat.numbers);
+    }
+}
+
+auto decode_sheet(const ModelSnapshot& snapshot) -> std::optional<Worksheet>
+{
+    if (snapshot.size() != 2 + N_OPERATIONS) {
+	return {};
+    }
+    const std::vector<size_t> depth = snapshot.array<size_t>(0);
+    std::vector<Operation> ops = snapshot.array<Operation>(1);
+    if (depth.size() != 1 || depth[0] < 1
+	|| !std::ranges::all_of(ops, [](Operation opr) -> bool { return static_cast<size_t>(opr) < N_OPERATIONS; })) {
+	return {};
+    }
+
+    Worksheet sheet(std::move(ops), depth[0]);
+    for (size_t iop = 0; iop < N_OPERATIONS; iop++) {
+	std::vector<Answer> numbers = snapshot.array<Answer>(2 + iop);
+	if (numbers.size() != sheet.batches.at(iop).numbers.size()) {
+	    return {};
+	}
+	sheet.batches.at(iop).numbers = std::move(numbers);
+    }
+    return sheet;
+}
+
 auto part_1(const std::string& input) -> Answer
 {
-    const std::vector<Problem> problems = parse_input(input);
-    return std::accumulate(problems.begin(), problems.end(), 0LL,
-			   [] (Answer acc, const Problem& prob) -> Answer {
-			       return acc + prob.answer();
-			   });
+    return parallel_total(cached_parse({6, 1, version(), 0}, input, parse_input, encode_sheet, decode_sheet));
 }
 
-auto parse_input_2(const std::string& input) -> std::vector<Problem> {
-    std::vector<Problem> problems;
+// Column-wise reading works on the raw buffer in blocks of columns: each
+// row is read contiguously over the block while the per-column digit
+// accumulators and "all rows are space" masks stay in registers/L1.
+constexpr size_t TRANSPOSE_BLOCK = 64;
+
+// Walk the digit rows column by column, calling f(value) for each number
+// column and f(std::nullopt) for each all-space separator column.
+template <typename F>
+constexpr auto transpose_columns(const std::vector<std::string_view>& rows, size_t width, F f) -> void {
+    std::array<Answer, TRANSPOSE_BLOCK> values{};
+    std::array<uint8_t, TRANSPOSE_BLOCK> blank{};
+
+    for (size_t base = 0; base < width; base += TRANSPOSE_BLOCK) {
+	const size_t len = std::min(TRANSPOSE_BLOCK, width - base);
+	values.fill(0);
+	blank.fill(1);
 
-    std::vector<std::string> lines = split_lines(input);
-    CHECK(input.size() >= 2);
+	for (const std::string_view& row : rows) {
+	    const char* cells = std::next(row.data(), static_cast<std::ptrdiff_t>(base));
+	    // Branch-free so that the compiler can vectorize the block
+	    for (size_t j = 0; j < len; j++) {
+		const char cell = cells[j]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		const bool is_digit = static_cast<unsigned char>(cell - '0') < 10; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		blank[j] &= static_cast<uint8_t>(cell == ' '); // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		values[j] = is_digit ? (values[j] * 10) + (cell - '0') : values[j]; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers,cppcoreguidelines-pro-bounds-constant-array-index)
+	    }
+	}
+
+	for (size_t j = 0; j < len; j++) {
+	    if (blank[j] != 0) { // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		f(std::optional<Answer>{});
+	    } else {
+		f(std::optional<Answer>{values[j]}); // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+	    }
+	}
+    }
+}
+
+constexpr auto parse_input_2(std::string_view input) -> Worksheet {
+    std::vector<std::string_view> rows = row_views(input);
+    CHECK(rows.size() >= 2);
 
     // Do operations firsts
-    std::ranges::transform(split_at(lines.back(), ' '), std::back_inserter(problems),
-			   [] (const std::string& opstr) -> Problem {
-			       if (opstr.size() != 1) {
-				   throw std::invalid_argument("Invalid opstr: " + opstr);
-			       }
-			       switch (opstr[0]) {
-			       case '+': return Problem(std::plus<Answer>{});
-			       case '-': return Problem(std::minus<Answer>{});
-			       case '*': return Problem(std::multiplies<Answer>{});
-			       default:
-				   throw std::invalid_argument("Invalid opstr: " + opstr);
-			       }
-			   });
-
-
-    const size_t width = lines.front().size();
-    CHECK(std::ranges::all_of(lines.begin(), std::prev(lines.end()),
-			     [=](const std::string& str)->bool{return str.size() == width;}));
-    
-    
-    std::vector<std::string> atoms;
-    for (size_t iwidth = 0; iwidth < width; iwidth++) {
-	if (atoms.size() <= iwidth) {
-	    atoms.emplace_back();
-	}
-	for (size_t iline = 0; iline < lines.size() - 1; iline++) {
-	    atoms.back().push_back(lines.at(iline).at(iwidth));
-	}
-    }
-
-    size_t iprob = 0;
-    size_t iatom = 0;
-    while (iprob < problems.size() && iatom < atoms.size()) {
-	if (std::ranges::all_of(atoms.at(iatom), [](char thec) -> bool {return thec == ' ';})) {
-	    iprob++;
+    std::vector<Operation> ops = parse_operations(rows.back());
+    rows.pop_back();
+
+    const size_t width = rows.front().size();
+    CHECK(std::ranges::all_of(rows, [=](std::string_view str)->bool{return str.size() == width;}));
+
+    // Problems have a variable number of columns: collect them first, then
+    // size the worksheet on the widest one
+    std::vector<Answer> values;
+    std::vector<size_t> offsets = {0};
+    transpose_columns(rows, width, [&](std::optional<Answer> value) -> void {
+	if (offsets.size() > ops.size()) {
+	    return;
+	}
+	if (value) {
+	    values.push_back(*value);
 	} else {
-	    problems.at(iprob).numbers.push_back(std::stoll(atoms.at(iatom)));
+	    offsets.push_back(values.size());
 	}
-	iatom++;
+    });
+    if (offsets.size() <= ops.size()) {
+	offsets.push_back(values.size());
     }
+    CHECK(offsets.size() == ops.size() + 1);
 
-    return problems;
+    size_t depth = 1;
+    for (size_t prob = 0; prob < ops.size(); prob++) {
+	depth = std::max(depth, offsets[prob + 1] - offsets[prob]);
+    }
+
+    Worksheet sheet(std::move(ops), depth);
+    for (size_t prob = 0; prob < sheet.size(); prob++) {
+	for (size_t idx = offsets[prob]; idx < offsets[prob + 1]; idx++) {
+	    sheet.number(prob, idx - offsets[prob]) = values[idx];
+	}
+    }
+
+    return sheet;
 
 }
 
 
 auto part_2(const std::string& input) -> Answer
 {
-    const std::vector<Problem> problems = parse_input_2(input);
-    return std::accumulate(problems.begin(), problems.end(), 0LL,
-			   [] (Answer acc, const Problem& prob) -> Answer {
-			       return acc + prob.answer();
-			   });
+    return parallel_total(cached_parse({6, 2, version(), 0}, input, parse_input_2, encode_sheet, decode_sheet));
+}
+
+constexpr std::string_view EXAMPLE =
+    "123 328  51 64 \n"
+    " 45 64  387 23 \n"
+    "  6 98  215 314\n"
+    "*   +   *   +\n";
+
+static_assert(parse_input(EXAMPLE).total() == 4277556);
+static_assert(parse_input_2(EXAMPLE).total<true>() == 3263827);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute([](std::string_view input) -> Answer { return parse_input(input).total(); }, embedded_file("inputs/day6.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute([](std::string_view input) -> Answer { return parse_input_2(input).total(); }, embedded_file("inputs/day6.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
+{
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
+}
+
+// Streaming evaluation: worksheets are a few rows tall but may be far
+// wider than memory, so every row gets its own read cursor and the rows
+// are consumed in lockstep, one problem span at a time.
+using StreamFactory = std::function<std::unique_ptr<std::istream>()>;
+
+class RowCursors {
+public:
+    explicit RowCursors(const StreamFactory& open);
+
+    // Read the next column of every row into column. Exhausted rows read
+    // as spaces. Returns false once every row is exhausted.
+    auto next(std::string& column) -> bool;
+
+    [[nodiscard]] auto nrows() const -> size_t { return m_rows.size(); }
+
+private:
+    std::vector<std::unique_ptr<std::istream>> m_rows;
+    std::vector<uint8_t> m_done;
+};
+
+RowCursors::RowCursors(const StreamFactory& open)
+{
+    // Locate the start of every non-empty row without keeping the rows
+    std::vector<std::streamoff> starts;
+    {
+	const std::unique_ptr<std::istream> scan = open();
+	std::streambuf* buf = scan->rdbuf();
+	std::streamoff pos = 0;
+	bool at_start = true;
+	for (int chr = buf->sbumpc(); chr != std::streambuf::traits_type::eof(); chr = buf->sbumpc(), pos++) {
+	    if (chr == '\n') {
+		at_start = true;
+	    } else if (at_start) {
+		starts.push_back(pos);
+		at_start = false;
+	    }
+	}
+    }
+
+    for (const std::streamoff start : starts) {
+	m_rows.push_back(open());
+	m_rows.back()->seekg(start);
+	CHECK(m_rows.back()->good());
+    }
+    m_done.assign(m_rows.size(), 0);
+}
+
+auto RowCursors::next(std::string& column) -> bool
+{
+    column.resize(m_rows.size());
+    bool more = false;
+    for (size_t row = 0; row < m_rows.size(); row++) {
+	column[row] = ' ';
+	if (m_done[row] != 0) {
+	    continue;
+	}
+	const int chr = m_rows[row]->rdbuf()->sbumpc();
+	if (chr == std::streambuf::traits_type::eof() || chr == '\n') {
+	    m_done[row] = 1;
+	} else {
+	    column[row] = static_cast<char>(chr);
+	    more = true;
+	}
+    }
+    return more;
+}
+
+auto fold(Operation opr, const std::vector<Answer>& numbers) -> Answer {
+    CHECK(!numbers.empty());
+    bool overflow = false;
+    Answer acc = numbers.front();
+    for (auto it = std::next(numbers.begin()); it != numbers.end(); it++) {
+	switch (opr) {
+	case Operation::plus: acc = combine<Operation::plus, false>(acc, *it, overflow); break;
+	case Operation::minus: acc = combine<Operation::minus, false>(acc, *it, overflow); break;
+	case Operation::multiplies: acc = combine<Operation::multiplies, false>(acc, *it, overflow); break;
+	}
+    }
+    return acc;
+}
+
+// span holds one string per row, each covering the columns of one problem;
+// the last row carries the operation.
+auto evaluate_span(const std::vector<std::string>& span, bool column_wise, std::vector<Answer>& numbers) -> Answer {
+    const std::string& opline = span.back();
+    const auto opchar = std::ranges::find_if(opline, [](char chr) -> bool { return chr != ' '; });
+    CHECK(opchar != opline.end());
+    const Operation opr = parse_operation(std::string_view(&*opchar, 1));
+
+    const size_t ndigits = span.size() - 1;
+    numbers.clear();
+    if (column_wise) {
+	for (size_t col = 0; col < opline.size(); col++) {
+	    Answer value = 0;
+	    for (size_t row = 0; row < ndigits; row++) {
+		if (span[row][col] != ' ') {
+		    value = (value * 10) + (span[row][col] - '0'); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		}
+	    }
+	    numbers.push_back(value);
+	}
+    } else {
+	for (size_t row = 0; row < ndigits; row++) {
+	    Answer value = 0;
+	    for (const char chr : span[row]) {
+		if (chr != ' ') {
+		    value = (value * 10) + (chr - '0'); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		}
+	    }
+	    numbers.push_back(value);
+	}
+    }
+    return fold(opr, numbers);
+}
+
+auto stream_evaluate(const StreamFactory& open, bool column_wise) -> Answer {
+    RowCursors cursors(open);
+    CHECK(cursors.nrows() >= 2);
+
+    std::vector<std::string> span(cursors.nrows());
+    std::vector<Answer> numbers;
+    std::string column;
+    Answer total = 0;
+
+    bool more = true;
+    while (more) {
+	more = cursors.next(column);
+	const bool blank = std::all_of(column.begin(), std::prev(column.end()),
+				       [](char chr) -> bool { return chr == ' '; });
+	if (!blank) {
+	    for (size_t row = 0; row < span.size(); row++) {
+		span[row].push_back(column[row]);
+	    }
+	} else if (!span.front().empty()) {
+	    total += evaluate_span(span, column_wise, numbers);
+	    std::ranges::for_each(span, [](std::string& str) -> void { str.clear(); });
+	}
+    }
+
+    return total;
+}
+
+auto stream_evaluate_file(const std::string& path, bool column_wise) -> Answer {
+    return stream_evaluate([&]() -> std::unique_ptr<std::istream> {
+	auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+	if (!*file) {
+	    throw std::runtime_error("Unable to open " + path);
+	}
+	return file;
+    }, column_wise);
 }
 
 void tests() // NOLINT(readability-function-cognitive-complexity)
 {
-    const std::string test_input =
-	"123 328  51 64 \n"
-	" 45 64  387 23 \n"
-	"  6 98  215 314\n"
-	"*   +   *   +\n";
-
-    const std::vector<Problem> test_problems = parse_input(test_input);
-    CHECK(test_problems.size() == 4);
-    CHECK(std::ranges::all_of(test_problems, [](const auto& prob)->bool{return prob.numbers.size() == 3;}));
-
-    CHECK(std::holds_alternative<std::multiplies<Answer>>(test_problems[0].operation));
-    CHECK(test_problems[0].numbers == std::vector<Answer>({123, 45, 6}));
-    CHECK(test_problems[0].answer() == 33210);
-    CHECK(test_problems[1].answer() == 490);
-    CHECK(test_problems[2].answer() == 4243455);
-    CHECK(test_problems[3].answer() == 401);
+    const std::string test_input(EXAMPLE);
+
+    const Worksheet test_sheet = parse_input(test_input);
+    CHECK(test_sheet.size() == 4);
+    CHECK(test_sheet.depth == 3);
+
+    CHECK(test_sheet.operations[0] == Operation::multiplies);
+    CHECK(test_sheet.number(0, 0) == 123);
+    CHECK(test_sheet.number(0, 1) == 45);
+    CHECK(test_sheet.number(0, 2) == 6);
+    CHECK(test_sheet.batch(0).problems == std::vector<size_t>({0, 2}));
+    CHECK(test_sheet.answers() == std::vector<Answer>({33210, 490, 4243455, 401}));
 
     CHECK(part_1(test_input) == 4277556);
 
-    const std::vector<Problem> test_problems_2 = parse_input_2(test_input);
-    CHECK(test_problems_2.size() == 4);
-    CHECK(test_problems_2.back().numbers.size() == 3);
-    CHECK(test_problems_2.back().numbers[0] == 623);
-    CHECK(test_problems_2.back().numbers[1] == 431);
-    CHECK(test_problems_2.back().numbers[2] == 4);
-    CHECK(test_problems_2[0].answer() == 8544);
-    CHECK(test_problems_2[1].answer() == 625);
-    CHECK(test_problems_2[2].answer() == 3253600);
-    CHECK(test_problems_2[3].answer() == 1058);
+    const Worksheet test_sheet_2 = parse_input_2(test_input);
+    CHECK(test_sheet_2.size() == 4);
+    CHECK(test_sheet_2.depth == 3);
+    CHECK(test_sheet_2.number(3, 0) == 623);
+    CHECK(test_sheet_2.number(3, 1) == 431);
+    CHECK(test_sheet_2.number(3, 2) == 4);
+    CHECK(test_sheet_2.answers<true>() == std::vector<Answer>({8544, 625, 3253600, 1058}));
 
     CHECK(part_2(test_input) == 3263827);
+
+    // Shorter problems are padded with the identity
+    const Worksheet test_sheet_3 = parse_input_2(
+	"12 1 9\n"
+	"34 2 9\n"
+	"-  * *\n");
+    CHECK(test_sheet_3.depth == 2);
+    CHECK(test_sheet_3.number(1, 1) == 1);
+    CHECK(test_sheet_3.answers() == std::vector<Answer>({13 - 24, 12, 99}));
+
+    // Overflow is only reported when asked for
+    const Worksheet test_sheet_4 = parse_input(
+	"9223372036854775807 2\n"
+	"2 3\n"
+	"* +\n");
+    bool overflowed = false;
+    try {
+	UNUSED(test_sheet_4.total<true>());
+    } catch (std::overflow_error&) {
+	overflowed = true;
+    }
+    CHECK(overflowed);
+    CHECK(test_sheet_4.answers()[1] == 5);
+
+    // Spans several transpose blocks, with separators on block boundaries
+    const std::vector<std::string> test_rows = split_lines(test_input);
+    std::string wide_input;
+    constexpr size_t n_repeat = 20;
+    for (const std::string& row : test_rows) {
+	std::string padded = row;
+	padded.resize(test_rows.front().size(), ' ');
+	for (size_t i = 0; i < n_repeat; i++) {
+	    wide_input += padded + (i + 1 < n_repeat ? " " : "");
+	}
+	wide_input += '\n';
+    }
+    CHECK(parse_input_2(wide_input).size() == 4 * n_repeat);
+    CHECK(part_2(wide_input) == 3263827 * static_cast<Answer>(n_repeat));
+
+    // Same answers whatever the number of threads
+    std::string many_problems;
+    for (const std::string& row : test_rows) {
+	std::string padded = row;
+	padded.resize(test_rows.front().size(), ' ');
+	for (size_t i = 0; i < 1000; i++) { // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	    many_problems += padded + " ";
+	}
+	many_problems.back() = '\n';
+    }
+    for (const size_t n_threads : {1, 4}) {
+	const ScopedThreads scoped(n_threads);
+	CHECK(part_1(many_problems) == Answer{4277556} * 1000);
+	CHECK(part_2(many_problems) == Answer{3263827} * 1000);
+    }
+
+    const CacheKey key{6, 2, version(), hash_bytes(wide_input)};
+    ModelWriter writer;
+    encode_sheet(parse_input_2(wide_input), writer);
+    const std::string encoded = writer.encode(key);
+    const std::optional<ModelSnapshot> snapshot = ModelSnapshot::decode(nullptr, std::as_bytes(std::span(encoded)), key);
+    CHECK(snapshot);
+    const std::optional<Worksheet> decoded = decode_sheet(*snapshot);
+    CHECK(decoded && decoded->answers() == parse_input_2(wide_input).answers());
+
+    const auto from_string = [](const std::string& str) -> StreamFactory {
+	return [&str]() -> std::unique_ptr<std::istream> { return std::make_unique<std::istringstream>(str); };
+    };
+    CHECK(stream_evaluate(from_string(test_input), false) == 4277556);
+    CHECK(stream_evaluate(from_string(test_input), true) == 3263827);
+    CHECK(stream_evaluate(from_string(wide_input), false) == 4277556 * static_cast<Answer>(n_repeat));
+    CHECK(stream_evaluate(from_string(wide_input), true) == 3263827 * static_cast<Answer>(n_repeat));
+
+    const ScratchDir scratch;
+    const std::filesystem::path wide_path = scratch.path() / "wide.txt";
+    std::ofstream(wide_path, std::ios::binary) << wide_input;
+    CHECK(stream_evaluate_file(wide_path.string(), false) == 4277556 * static_cast<Answer>(n_repeat));
+    CHECK(stream_evaluate_file(wide_path.string(), true) == 3263827 * static_cast<Answer>(n_repeat));
 }
 
      
 } // namespace day6
-
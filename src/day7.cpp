@@ -1,100 +1,243 @@
 #include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream> // NOLINT(misc-include-cleaner)
+#include <istream>
 #include <iterator>
-#include <map>
+#include <limits>
 #include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "commands.hpp"
 #include "common.hpp"
 
 namespace day7 {
 
+auto version() -> std::string_view { return SOURCE_HASH; }
+
 constexpr char SOURCE_SYMBOL = 'S';
 constexpr char SPLITTER_SYMBOL = '^';
 
-struct Splitters {
-    using Pos = std::pair<int64_t, int64_t>;
-    std::map<Pos, std::vector<Pos>> map;
-    std::map<Pos, Answer> counts;
-    std::pair<int64_t, int64_t> limits;
-    std::pair<int64_t, int64_t> source;
-
-    auto mark_activations() -> void;
-    auto mark_activations(std::pair<int64_t, int64_t> from, std::pair<int64_t, int64_t> parent) -> void;
-
-    auto count_activations() -> void;
+using Pos = std::pair<int64_t, int64_t>;
+
+// Splitter graph in compressed sparse row form. Nodes are numbered in
+// row-major order; beams only move down, so that order is topological.
+// Edges only leave splitters that a beam reaches: a splitter that is
+// never activated has neither parents nor children.
+struct SplitterDag {
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    std::vector<Pos> nodes;
+    std::vector<size_t> child_offsets;
+    std::vector<size_t> children;
+    std::vector<size_t> parent_offsets;
+    std::vector<size_t> parents;
+    std::vector<Answer> paths; // Number of timelines reaching each node
+    size_t root{NONE}; // First splitter below the source
+    Pos source;
+    Pos limits;
+
+    SplitterDag(std::vector<Pos> splitters, Pos src, Pos lims);
+
+    [[nodiscard]] auto find(Pos pos) const -> std::optional<size_t>;
+    [[nodiscard]] auto fan_out(size_t node) const -> size_t;
+    [[nodiscard]] auto fan_in(size_t node) const -> size_t;
+    [[nodiscard]] auto path_count(size_t node) const -> Answer { return paths.at(node); }
+    [[nodiscard]] auto leaves() const -> std::vector<size_t>;
+    [[nodiscard]] auto activations() const -> Answer;
+    [[nodiscard]] auto timelines() const -> Answer;
+
+private:
+    auto link(const std::vector<size_t>& left, const std::vector<size_t>& right) -> void;
+    auto evaluate() -> void;
 };
 
-auto parse_input(const std::string &input) -> Splitters {
-    Splitters splitters;
-    std::vector<std::string> lines = split_lines(input);
-    splitters.limits.first = static_cast<int64_t>(lines.size());
-    splitters.limits.second = static_cast<int64_t>(lines.front().size());
-    for (auto i_it = lines.begin(); i_it != lines.end(); i_it++) {
-	const int64_t i_pos = std::distance(lines.begin(), i_it);
-        for (auto j_it = i_it->begin(); j_it != i_it->end(); j_it++) {
-            const int64_t j_pos = std::distance(i_it->begin(), j_it);
-            if (*j_it == SOURCE_SYMBOL) {
-		splitters.source = {i_pos, j_pos};
-            } else if (*j_it == SPLITTER_SYMBOL) {
-		splitters.map.insert({{i_pos, j_pos}, {}});
+SplitterDag::SplitterDag(std::vector<Pos> splitters, Pos src, Pos lims)
+    : nodes{std::move(splitters)}, source{src}, limits{lims}
+{
+    CHECK(std::ranges::is_sorted(nodes));
+    const size_t n_nodes = nodes.size();
+
+    // Sweep rows bottom-up, remembering the nearest splitter below in
+    // every column. Links are resolved for a whole row before the row is
+    // recorded, since side beams skip splitters on their own row.
+    std::vector<size_t> below(static_cast<size_t>(limits.second), NONE);
+    std::vector<size_t> left(n_nodes, NONE);
+    std::vector<size_t> right(n_nodes, NONE);
+    bool rooted = false;
+
+    size_t end = n_nodes;
+    while (end > 0) {
+	const int64_t row = nodes[end - 1].first;
+	size_t begin = end;
+	while (begin > 0 && nodes[begin - 1].first == row) {
+	    begin--;
+	}
+	if (!rooted && row <= source.first) {
+	    root = below.at(static_cast<size_t>(source.second));
+	    rooted = true;
+	}
+	for (size_t node = begin; node < end; node++) {
+	    const auto col = static_cast<size_t>(nodes[node].second);
+	    left[node] = col > 0 ? below[col - 1] : NONE;
+	    right[node] = col + 1 < below.size() ? below[col + 1] : NONE;
+	}
+	for (size_t node = begin; node < end; node++) {
+	    below[static_cast<size_t>(nodes[node].second)] = node;
+	}
+	end = begin;
+    }
+    if (!rooted) {
+	root = below.at(static_cast<size_t>(source.second));
+    }
+
+    // Children are numbered after their parents, so one forward pass
+    // finds every splitter reached from the root
+    std::vector<bool> reached(n_nodes, false);
+    if (root != NONE) {
+	reached[root] = true;
+    }
+    for (size_t node = 0; node < n_nodes; node++) {
+	if (!reached[node]) {
+	    left[node] = NONE;
+	    right[node] = NONE;
+	    continue;
+	}
+	for (const size_t child : {left[node], right[node]}) {
+	    if (child != NONE) {
+		reached[child] = true;
 	    }
-        }
+	}
     }
-    return splitters;
+
+    link(left, right);
+    evaluate();
 }
 
+auto SplitterDag::link(const std::vector<size_t>& left, const std::vector<size_t>& right) -> void {
+    const size_t n_nodes = nodes.size();
 
-auto Splitters::mark_activations(std::pair<int64_t, int64_t> from, std::pair<int64_t, int64_t> parent) -> void {
+    child_offsets.assign(n_nodes + 1, 0);
+    std::vector<size_t> n_parents(n_nodes, 0);
+    for (size_t node = 0; node < n_nodes; node++) {
+	for (const size_t child : {left[node], right[node]}) {
+	    if (child != NONE) {
+		child_offsets[node + 1]++;
+		n_parents[child]++;
+	    }
+	}
+    }
+    std::partial_sum(child_offsets.begin(), child_offsets.end(), child_offsets.begin());
+
+    parent_offsets.assign(n_nodes + 1, 0);
+    std::partial_sum(n_parents.begin(), n_parents.end(), std::next(parent_offsets.begin()));
+
+    children.resize(child_offsets.back());
+    parents.resize(parent_offsets.back());
+    std::vector<size_t> fill(parent_offsets.begin(), std::prev(parent_offsets.end()));
+    for (size_t node = 0; node < n_nodes; node++) {
+	size_t pos = child_offsets[node];
+	for (const size_t child : {left[node], right[node]}) {
+	    if (child != NONE) {
+		children[pos++] = child;
+		parents[fill[child]++] = node;
+	    }
+	}
+    }
+}
 
-    // Terminal cases
-    if (from.first >= limits.first || from.second >= limits.second || from.first < 0 || from.second < 0) {
-        return;
+auto SplitterDag::evaluate() -> void {
+    paths.assign(nodes.size(), 0);
+    if (root == NONE) {
+	return;
     }
-    
-    if (map.contains({from.first + 1, from.second})) {
-	const bool first_visit = map.at({from.first + 1, from.second}).empty();
-	map.at({from.first + 1, from.second}).push_back(parent);
-        if (first_visit) {
-	    mark_activations({from.first + 1, from.second - 1}, {from.first + 1, from.second});
-            mark_activations({from.first + 1, from.second + 1}, {from.first + 1, from.second});
+    paths[root] = 1;
+    for (size_t node = 0; node < nodes.size(); node++) {
+	for (size_t edge = child_offsets[node]; edge < child_offsets[node + 1]; edge++) {
+	    paths[children[edge]] += paths[node];
 	}
-    } else {
-	mark_activations({from.first + 1, from.second}, parent);
     }
 }
 
-auto Splitters::mark_activations() -> void {
-    mark_activations(source, source);
+auto SplitterDag::find(Pos pos) const -> std::optional<size_t> {
+    const auto iter = std::ranges::lower_bound(nodes, pos);
+    if (iter == nodes.end() || *iter != pos) {
+	return {};
+    }
+    return static_cast<size_t>(std::distance(nodes.begin(), iter));
 }
 
+auto SplitterDag::fan_out(size_t node) const -> size_t {
+    return child_offsets.at(node + 1) - child_offsets.at(node);
+}
 
-auto part_1(const std::string &input) -> Answer {
-    Splitters splitters = parse_input(input);
-    splitters.mark_activations();
-    return std::ranges::count_if(splitters.map, [](const auto& x)->bool{return !x.second.empty();});
+auto SplitterDag::fan_in(size_t node) const -> size_t {
+    return parent_offsets.at(node + 1) - parent_offsets.at(node);
 }
 
-auto Splitters::count_activations() -> void {
-    for (int64_t rank = 0; rank < limits.first; rank++) {
-	std::ranges::for_each(map, [&](const auto& pair) -> void {
-	    auto& [pos, parents] = pair;
-	    if (parents.empty()) {
-		counts[pos] = 0;
-	    } else {
-		counts[pos] = std::accumulate(parents.begin(), parents.end(), 0LL,
-					      [&](Answer acc, const auto &ppos) -> Answer {
-						  if (ppos == source) {
-						      return 1;
-						  }
-						  return acc + counts.at(ppos);
-					      });
-	    }
-	});
+// Splitters without children: those whose beams both leave without
+// hitting another one, and those never activated
+auto SplitterDag::leaves() const -> std::vector<size_t> {
+    std::vector<size_t> result;
+    for (size_t node = 0; node < nodes.size(); node++) {
+	if (fan_out(node) == 0) {
+	    result.push_back(node);
+	}
     }
+    return result;
+}
+
+auto SplitterDag::activations() const -> Answer {
+    return std::ranges::count_if(paths, [](Answer count) -> bool { return count != 0; });
+}
+
+// Every beam that does not reach another splitter ends one timeline
+auto SplitterDag::timelines() const -> Answer {
+    if (root == NONE) {
+	return 1;
+    }
+    Answer total = 0;
+    for (size_t node = 0; node < nodes.size(); node++) {
+	total += static_cast<Answer>(2 - fan_out(node)) * paths[node];
+    }
+    return total;
+}
+
+auto parse_input(const std::string &input) -> SplitterDag {
+    std::vector<Pos> splitters;
+    std::optional<Pos> source;
+    Pos limits{0, 0};
+
+    for_each_line(input, [&](std::string_view line) -> void {
+	if (limits.first == 0) {
+	    limits.second = static_cast<int64_t>(line.size());
+	}
+	CHECK(static_cast<int64_t>(line.size()) == limits.second);
+
+	const size_t src = line.find(SOURCE_SYMBOL);
+	if (src != std::string_view::npos) {
+	    source = Pos{limits.first, src};
+	}
+	for (size_t col = line.find(SPLITTER_SYMBOL); col != std::string_view::npos;
+	     col = line.find(SPLITTER_SYMBOL, col + 1)) {
+	    splitters.emplace_back(limits.first, col);
+	}
+	limits.first++;
+    });
+
+    CHECK(source.has_value());
+    return {std::move(splitters), *source, limits};
 }
 
 template <typename T> auto printv(const std::vector<T>& v) -> void {
@@ -102,80 +245,556 @@ template <typename T> auto printv(const std::vector<T>& v) -> void {
     std::cout << "\n";
 }
 
-auto count_children(const Splitters& splitters, const std::pair<int64_t, int64_t>& cand) -> int64_t {
-    const int64_t n = std::ranges::count_if(splitters.map, [&](const auto& pair) -> bool {
-	    std::vector<std::pair<int64_t, int64_t>> parents = pair.second;
-	    const bool found = std::ranges::find(parents, cand) != parents.end();
-	    return found;
+// Dense row-by-row sweep: beams only ever move down, so the state of a
+// row depends only on the row above. paths[j] is the number of timelines
+// in which a beam occupies column j of the current row (0 = no beam).
+struct BeamSweep {
+    Answer activations{0};
+    Answer timelines{0};
+};
+
+auto sweep(const std::string& input) -> BeamSweep {
+    BeamSweep result;
+    std::vector<Answer> paths;
+    std::vector<Answer> next;
+    size_t width = 0;
+
+    for_each_line(input, [&](std::string_view line) -> void {
+	if (paths.empty()) {
+	    width = line.size();
+	    paths.assign(width, 0);
+	    next.assign(width, 0);
+	    const size_t src = line.find(SOURCE_SYMBOL);
+	    CHECK(src != std::string_view::npos);
+	    paths[src] = 1;
+	    return;
+	}
+	CHECK(line.size() == width);
+
+	std::ranges::fill(next, 0);
+	for (size_t j = 0; j < width; j++) {
+	    const Answer count = paths[j];
+	    if (count == 0) {
+		continue;
+	    }
+	    if (line[j] != SPLITTER_SYMBOL) {
+		next[j] += count;
+		continue;
+	    }
+	    result.activations++;
+	    // Beams leaving the manifold sideways end their timeline here
+	    if (j > 0) {
+		next[j - 1] += count;
+	    } else {
+		result.timelines += count;
+	    }
+	    if (j + 1 < width) {
+		next[j + 1] += count;
+	    } else {
+		result.timelines += count;
+	    }
+	}
+	std::swap(paths, next);
+    });
+
+    result.timelines = std::accumulate(paths.begin(), paths.end(), result.timelines);
+    return result;
+}
+
+// Bitboard engine for part 1: each row's beams and splitters are packed
+// 64 columns per word, bit k of word w standing for column 64 * w + k.
+constexpr size_t WORD_BITS = 64;
+
+constexpr auto splitter_bits(std::string_view line, std::vector<uint64_t>& bits) -> void {
+    for (size_t word = 0; word < bits.size(); word++) {
+	const size_t base = word * WORD_BITS;
+	const size_t len = std::min(WORD_BITS, line.size() - base);
+	uint64_t mask = 0;
+	for (size_t k = 0; k < len; k++) {
+	    mask |= static_cast<uint64_t>(line[base + k] == SPLITTER_SYMBOL) << k;
+	}
+	bits[word] = mask;
+    }
+}
+
+constexpr auto bitboard_activations(std::string_view input) -> Answer {
+    Answer activations = 0;
+    std::vector<uint64_t> beams;
+    std::vector<uint64_t> splitters;
+    std::vector<uint64_t> hits;
+    size_t width = 0;
+    uint64_t tail = 0; // Valid bits of the last word
+
+    for_each_line(input, [&](std::string_view line) -> void {
+	if (beams.empty()) {
+	    width = line.size();
+	    const size_t n_words = (width + WORD_BITS - 1) / WORD_BITS;
+	    beams.assign(n_words, 0);
+	    splitters.assign(n_words, 0);
+	    hits.assign(n_words, 0);
+	    tail = (width % WORD_BITS == 0) ? ~uint64_t{0} : ((uint64_t{1} << (width % WORD_BITS)) - 1);
+	    const size_t src = line.find(SOURCE_SYMBOL);
+	    CHECK(src != std::string_view::npos);
+	    beams[src / WORD_BITS] = uint64_t{1} << (src % WORD_BITS);
+	    return;
+	}
+	CHECK(line.size() == width);
+
+	splitter_bits(line, splitters);
+	const size_t n_words = beams.size();
+	for (size_t word = 0; word < n_words; word++) {
+	    hits[word] = beams[word] & splitters[word];
+	    activations += std::popcount(hits[word]);
+	}
+	// Split beams move one column sideways, carrying across words
+	for (size_t word = 0; word < n_words; word++) {
+	    const uint64_t from_left = word > 0 ? hits[word - 1] >> (WORD_BITS - 1) : 0;
+	    const uint64_t from_right = word + 1 < n_words ? hits[word + 1] << (WORD_BITS - 1) : 0;
+	    beams[word] = (beams[word] & ~splitters[word])
+		| (hits[word] << 1) | from_left
+		| (hits[word] >> 1) | from_right;
+	}
+	beams.back() &= tail;
     });
-    return n;
+
+    return activations;
 }
 
-auto leaf_nodes(const Splitters& splitters) -> std::vector<std::pair<int64_t, int64_t>> {
-    std::vector<std::pair<int64_t, int64_t>> leaves;
-    std::ranges::for_each(splitters.map, [&] (const auto& pair) -> void {
-	if (count_children(splitters, pair.first) == 0) {
-	    leaves.push_back(pair.first);
+// Lane engine for part 2: the dense sweep written branch-free so that
+// every column is one lane of 64-bit path counts. Columns are padded by
+// one cell on each side; hits landing there have left the manifold.
+constexpr auto lane_timelines(std::string_view input) -> Answer {
+    Answer exits = 0;
+    std::vector<Answer> paths;
+    std::vector<Answer> next;
+    std::vector<Answer> hits;
+    size_t width = 0;
+
+    for_each_line(input, [&](std::string_view line) -> void {
+	if (paths.empty()) {
+	    width = line.size();
+	    paths.assign(width + 2, 0);
+	    next.assign(width + 2, 0);
+	    hits.assign(width + 2, 0);
+	    const size_t src = line.find(SOURCE_SYMBOL);
+	    CHECK(src != std::string_view::npos);
+	    paths[src + 1] = 1;
+	    return;
 	}
+	CHECK(line.size() == width);
+
+	for (size_t j = 0; j < width; j++) {
+	    const Answer mask = -static_cast<Answer>(line[j] == SPLITTER_SYMBOL);
+	    hits[j + 1] = paths[j + 1] & mask;
+	}
+	exits += hits[1] + hits[width];
+	for (size_t j = 1; j <= width; j++) {
+	    next[j] = (paths[j] - hits[j]) + hits[j - 1] + hits[j + 1];
+	}
+	std::swap(paths, next);
     });
-    return leaves;
+
+    return std::accumulate(paths.begin(), paths.end(), exits);
 }
 
+// Sparse mode for manifolds far wider than they are populated: only the
+// splitter coordinates are kept, rows are visited as events, and the
+// active beams live in a flat vector of (column, path count) sorted by
+// column. Coordinate lists have a "<width>,<source row>,<source col>"
+// header followed by one "<row>,<col>" line per splitter.
+struct SparseManifold {
+    int64_t width{0};
+    Pos source;
+    std::vector<Pos> splitters;
+};
+
+auto parse_coordinates(std::istream& stream) -> SparseManifold {
+    SparseManifold manifold;
+    const std::vector<std::string> lines = split_at(stream, '\n');
+    CHECK(!lines.empty());
+
+    const std::vector<std::string> header = split_at(lines.front(), ',');
+    CHECK(header.size() == 3);
+    manifold.width = std::stoll(header[0]);
+    manifold.source = {std::stoll(header[1]), std::stoll(header[2])};
+    CHECK(manifold.source.second >= 0 && manifold.source.second < manifold.width); // NOLINT(readability-simplify-boolean-expr)
+
+    std::transform(std::next(lines.begin()), lines.end(), std::back_inserter(manifold.splitters),
+		   [&](const std::string& line) -> Pos {
+		       const std::vector<std::string> fields = split_at(line, ',');
+		       CHECK(fields.size() == 2);
+		       const Pos pos{std::stoll(fields[0]), std::stoll(fields[1])};
+		       CHECK(pos.second >= 0 && pos.second < manifold.width); // NOLINT(readability-simplify-boolean-expr)
+		       return pos;
+		   });
+    return manifold;
+}
 
+auto parse_coordinates(const std::string& input) -> SparseManifold {
+    std::stringstream stream(input);
+    return parse_coordinates(stream);
+}
+
+// Beams from neighbouring columns can land out of order by at most two
+// places, so the merge point is found by walking back from the end.
+auto add_beam(std::vector<std::pair<int64_t, Answer>>& beams, int64_t col, Answer count) -> void {
+    auto iter = beams.end();
+    while (iter != beams.begin() && std::prev(iter)->first > col) {
+	iter = std::prev(iter);
+    }
+    if (iter != beams.begin() && std::prev(iter)->first == col) {
+	std::prev(iter)->second += count;
+    } else {
+	beams.emplace(iter, col, count);
+    }
+}
+
+auto sparse_sweep(SparseManifold manifold) -> BeamSweep {
+    BeamSweep result;
+    std::ranges::sort(manifold.splitters);
+
+    std::vector<std::pair<int64_t, Answer>> beams = {{manifold.source.second, 1}};
+    std::vector<std::pair<int64_t, Answer>> next;
+
+    auto row_begin = std::ranges::upper_bound(manifold.splitters, Pos{manifold.source.first, manifold.width});
+    while (row_begin != manifold.splitters.end() && !beams.empty()) {
+	const int64_t row = row_begin->first;
+	const auto row_end = std::find_if(row_begin, manifold.splitters.end(),
+					  [&](const Pos& pos) -> bool { return pos.first != row; });
+
+	next.clear();
+	auto splitter = row_begin;
+	for (const auto& [col, count] : beams) {
+	    while (splitter != row_end && splitter->second < col) {
+		splitter = std::next(splitter);
+	    }
+	    if (splitter == row_end || splitter->second != col) {
+		add_beam(next, col, count);
+		continue;
+	    }
+	    result.activations++;
+	    if (col > 0) {
+		add_beam(next, col - 1, count);
+	    } else {
+		result.timelines += count;
+	    }
+	    if (col + 1 < manifold.width) {
+		add_beam(next, col + 1, count);
+	    } else {
+		result.timelines += count;
+	    }
+	}
+	std::swap(beams, next);
+	row_begin = row_end;
+    }
+
+    result.timelines = std::accumulate(beams.begin(), beams.end(), result.timelines,
+				       [](Answer acc, const auto& beam) -> Answer { return acc + beam.second; });
+    return result;
+}
+
+// Snapshot arrays: width and source, then splitter rows and columns
+auto encode_coordinates(const SparseManifold& manifold, ModelWriter& writer) -> void {
+    std::vector<int64_t> rows;
+    std::vector<int64_t> cols;
+    for (const auto& [row, col] : manifold.splitters) {
+	rows.push_back(row);
+	cols.push_back(col);
+    }
+    writer.add(std::vector<int64_t>{manifold.width, manifold.source.first, manifold.source.second});
+    writer.add(rows);
+    writer.add(cols);
+}
+
+auto decode_coordinates(const ModelSnapshot& snapshot) -> std::optional<SparseManifold> {
+    if (snapshot.size() != 3) {
+	return {};
+    }
+    const std::vector<int64_t> header = snapshot.array<int64_t>(0);
+    const std::vector<int64_t> rows = snapshot.array<int64_t>(1);
+    const std::vector<int64_t> cols = snapshot.array<int64_t>(2);
+    if (header.size() != 3 || rows.size() != cols.size()) {
+	return {};
+    }
+    SparseManifold manifold{header[0], {header[1], header[2]}, {}};
+    manifold.splitters.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+	manifold.splitters.emplace_back(rows[i], cols[i]);
+    }
+    return manifold;
+}
+
+// Coordinate files are the one day 7 input whose parse dominates: the
+// grid engines scan text as fast as a snapshot could be read back.
+auto sparse_sweep_file(const std::string& path, int part) -> Answer {
+    CHECK(part == 1 || part == 2); // NOLINT(readability-simplify-boolean-expr)
+    std::ifstream ifile(path);
+    if (!ifile) {
+	throw std::runtime_error("Unable to open " + path);
+    }
+    std::stringstream buffer;
+    buffer << ifile.rdbuf();
+    const std::string input = buffer.str();
+    const BeamSweep result = sparse_sweep(cached_parse({7, 0, version(), 0}, input,
+						       [](std::string_view text) -> SparseManifold { return parse_coordinates(std::string(text)); },
+						       encode_coordinates, decode_coordinates));
+    return part == 1 ? result.activations : result.timelines;
+}
+
+// Timelines for every possible entry column of the source row at once:
+// sweeping bottom-up, below[j] is the number of timelines of a beam
+// travelling down column j, which only depends on the rows underneath.
+auto all_source_timelines(const std::string& input) -> std::vector<Answer> {
+    const GridView<const char> grid = text_grid(input);
+    CHECK(grid.nrows > 0);
+
+    size_t source_row = 0;
+    while (source_row < grid.nrows && std::ranges::count(grid.row(source_row), SOURCE_SYMBOL) == 0) {
+	source_row++;
+    }
+    CHECK(source_row < grid.nrows);
+
+    const size_t width = grid.ncols;
+    std::vector<Answer> below(width, 1);
+    std::vector<Answer> above(width, 0);
+    for (size_t row = grid.nrows - 1; row > source_row; row--) {
+	const std::span<const char> line = grid.row(row);
+	for (size_t j = 0; j < width; j++) {
+	    if (line[j] != SPLITTER_SYMBOL) {
+		above[j] = below[j];
+		continue;
+	    }
+	    // Beams leaving the manifold sideways are one timeline each
+	    above[j] = (j > 0 ? below[j - 1] : 1) + (j + 1 < width ? below[j + 1] : 1);
+	}
+	std::swap(below, above);
+    }
+
+    return below;
+}
+
+// Incremental engine for interactive editing: the path counts entering
+// every row below the source are kept, and an edit only recomputes the
+// cone of columns below it that actually changed, stopping as soon as a
+// row comes out unchanged.
+class IncrementalManifold {
+public:
+    explicit IncrementalManifold(const std::string& input);
+
+    auto set_splitter(size_t row, size_t col, bool present) -> void;
+
+    [[nodiscard]] auto activations() const -> Answer { return m_activations; }
+    [[nodiscard]] auto timelines() const -> Answer { return m_timelines; }
+    [[nodiscard]] auto to_string() const -> std::string;
+
+private:
+    [[nodiscard]] auto is_splitter(size_t level, size_t col) const -> bool;
+    [[nodiscard]] auto propagate(size_t level, size_t col) const -> Answer;
+    auto contribute(size_t level, size_t col, Answer sign) -> void;
+
+    std::vector<std::string> m_rows;
+    size_t m_source_row{0};
+    size_t m_width{0};
+    // m_beams[k][j]: paths down column j entering row m_source_row + 1 + k;
+    // the last level holds the beams leaving the manifold at the bottom.
+    std::vector<std::vector<Answer>> m_beams;
+    Answer m_activations{0};
+    Answer m_timelines{0};
+};
+
+IncrementalManifold::IncrementalManifold(const std::string& input)
+{
+    for_each_line(input, [&](std::string_view line) -> void { m_rows.emplace_back(line); });
+    CHECK(!m_rows.empty());
+    m_width = m_rows.front().size();
+    CHECK(std::ranges::all_of(m_rows, [&](const std::string& row) -> bool { return row.size() == m_width; }));
+
+    const auto source = std::ranges::find_if(m_rows, [](const std::string& row) -> bool {
+	return row.find(SOURCE_SYMBOL) != std::string::npos;
+    });
+    CHECK(source != m_rows.end());
+    m_source_row = static_cast<size_t>(std::distance(m_rows.begin(), source));
+
+    const size_t n_levels = m_rows.size() - m_source_row;
+    m_beams.assign(n_levels, std::vector<Answer>(m_width, 0));
+    m_beams.front()[source->find(SOURCE_SYMBOL)] = 1;
+    for (size_t level = 0; level < n_levels; level++) {
+	for (size_t col = 0; col < m_width; col++) {
+	    if (level > 0) {
+		m_beams[level][col] = propagate(level - 1, col);
+	    }
+	    contribute(level, col, 1);
+	}
+    }
+}
+
+auto IncrementalManifold::is_splitter(size_t level, size_t col) const -> bool {
+    return m_rows[m_source_row + 1 + level][col] == SPLITTER_SYMBOL;
+}
+
+// Paths leaving row `level` down column col
+auto IncrementalManifold::propagate(size_t level, size_t col) const -> Answer {
+    const std::vector<Answer>& beams = m_beams[level];
+    Answer count = is_splitter(level, col) ? 0 : beams[col];
+    if (col > 0 && is_splitter(level, col - 1)) {
+	count += beams[col - 1];
+    }
+    if (col + 1 < m_width && is_splitter(level, col + 1)) {
+	count += beams[col + 1];
+    }
+    return count;
+}
+
+// Add (sign = 1) or remove (sign = -1) what one cell adds to the answers
+auto IncrementalManifold::contribute(size_t level, size_t col, Answer sign) -> void {
+    const Answer count = m_beams[level][col];
+    if (level + 1 == m_beams.size()) {
+	m_timelines += sign * count;
+	return;
+    }
+    if (count == 0 || !is_splitter(level, col)) {
+	return;
+    }
+    m_activations += sign;
+    // Beams leaving the manifold sideways end their timeline here
+    m_timelines += sign * count * static_cast<Answer>((col == 0) + (col + 1 == m_width));
+}
+
+auto IncrementalManifold::set_splitter(size_t row, size_t col, bool present) -> void {
+    CHECK(row < m_rows.size());
+    CHECK(col < m_width);
+    CHECK(m_rows[row][col] != SOURCE_SYMBOL);
+    const char symbol = present ? SPLITTER_SYMBOL : '.';
+    if (m_rows[row][col] == symbol) {
+	return;
+    }
+    if (row <= m_source_row) {
+	m_rows[row][col] = symbol;
+	return;
+    }
+
+    size_t level = row - m_source_row - 1;
+    contribute(level, col, -1);
+    m_rows[row][col] = symbol;
+    contribute(level, col, 1);
+
+    size_t low = col;
+    size_t high = col;
+    for (; level + 1 < m_beams.size(); level++) {
+	const size_t first = low > 0 ? low - 1 : 0;
+	const size_t last = std::min(high + 1, m_width - 1);
+	std::optional<std::pair<size_t, size_t>> changed;
+	for (size_t j = first; j <= last; j++) {
+	    const Answer count = propagate(level, j);
+	    if (count == m_beams[level + 1][j]) {
+		continue;
+	    }
+	    contribute(level + 1, j, -1);
+	    m_beams[level + 1][j] = count;
+	    contribute(level + 1, j, 1);
+	    changed = changed ? std::make_pair(changed->first, j) : std::make_pair(j, j);
+	}
+	if (!changed) {
+	    break;
+	}
+	std::tie(low, high) = *changed;
+    }
+}
+
+auto IncrementalManifold::to_string() const -> std::string {
+    std::string result;
+    for (const std::string& row : m_rows) {
+	result += row + '\n';
+    }
+    return result;
+}
+
+// Each edit line is "ROW COL SYMBOL", SYMBOL being ^ to place a splitter
+// or . to clear one. Both answers are written once for the input, then
+// after every edit, and flushed so that the caller can wait for them.
+auto edit_manifold(const std::string& input, std::istream& edits, std::ostream& answers) -> void {
+    IncrementalManifold manifold(input);
+    answers << manifold.activations() << " " << manifold.timelines() << '\n' << std::flush;
+    std::string line;
+    while (std::getline(edits, line)) {
+	if (line.find_first_not_of(" \t\r") == std::string::npos) {
+	    continue;
+	}
+	std::istringstream fields(line);
+	size_t row = 0;
+	size_t col = 0;
+	char symbol = 0;
+	std::string rest;
+	if (!(fields >> row >> col >> symbol) || (symbol != SPLITTER_SYMBOL && symbol != '.') || (fields >> rest)) {
+	    throw std::runtime_error("Malformed edit: " + line);
+	}
+	manifold.set_splitter(row, col, symbol == SPLITTER_SYMBOL);
+	answers << manifold.activations() << " " << manifold.timelines() << '\n' << std::flush;
+    }
+}
+
+auto part_1(const std::string &input) -> Answer {
+    return bitboard_activations(input);
+}
 
 auto part_2(const std::string &input) -> Answer {
-    Splitters splitters = parse_input(input);
-    splitters.mark_activations();
-    splitters.count_activations();
-    // std::vector<std::pair<int64_t, int64_t>> leaves = leaf_nodes(splitters);
-    return std::accumulate(splitters.map.begin(), splitters.map.end(), 0LL,
-			   [&] (Answer acc, const auto& pair) -> Answer {
-			       const int64_t f = 2 - count_children(splitters, pair.first);
-			       return acc + (f * splitters.counts.at(pair.first));
-			   });
+    return lane_timelines(input);
 }
 
-void tests() // NOLINT(readability-function-cognitive-complexity)
+constexpr std::string_view EXAMPLE =
+    ".......S.......\n"
+    "...............\n"
+    ".......^.......\n"
+    "...............\n"
+    "......^.^......\n"
+    "...............\n"
+    ".....^.^.^.....\n"
+    "...............\n"
+    "....^.^...^....\n"
+    "...............\n"
+    "...^.^...^.^...\n"
+    "...............\n"
+    "..^...^.....^..\n"
+    "...............\n"
+    ".^.^.^.^.^...^.\n"
+    "...............\n";
+
+static_assert(bitboard_activations(EXAMPLE) == 21);
+static_assert(lane_timelines(EXAMPLE) == 40);
+
+constexpr std::optional<Answer> PRECOMPUTED_1 = precompute(bitboard_activations, embedded_file("inputs/day7.txt"));
+constexpr std::optional<Answer> PRECOMPUTED_2 = precompute(lane_timelines, embedded_file("inputs/day7.txt"));
+
+auto precomputed(int part) -> std::optional<Answer>
 {
-    const std::string test_input = ".......S.......\n"
-                                   "...............\n"
-                                   ".......^.......\n"
-                                   "...............\n"
-                                   "......^.^......\n"
-                                   "...............\n"
-                                   ".....^.^.^.....\n"
-                                   "...............\n"
-                                   "....^.^...^....\n"
-                                   "...............\n"
-                                   "...^.^...^.^...\n"
-                                   "...............\n"
-                                   "..^...^.....^..\n"
-                                   "...............\n"
-                                   ".^.^.^.^.^...^.\n"
-                                   "...............\n";
-
-    Splitters splitters = parse_input(test_input);
-    CHECK(splitters.source.first == 0);
-    CHECK(splitters.source.second == 7);
-    CHECK(splitters.map.size() == 22);
-
-    splitters.mark_activations();
-    CHECK(splitters.map.at({2, 7}).size() == 1);
-    CHECK(splitters.map.at({2, 7}).size() == 1);
-    CHECK(splitters.map.at({6, 7}).size() == 2);
-    CHECK(splitters.map.at({14, 9}).empty());
+    return part == 1 ? PRECOMPUTED_1 : PRECOMPUTED_2;
+}
 
+void tests() // NOLINT(readability-function-cognitive-complexity)
+{
+    const std::string test_input(EXAMPLE);
+
+    SplitterDag dag = parse_input(test_input);
+    CHECK(dag.source.first == 0);
+    CHECK(dag.source.second == 7);
+    CHECK(dag.nodes.size() == 22);
+    CHECK(dag.root == *dag.find({2, 7}));
+
+    CHECK(dag.fan_in(*dag.find({2, 7})) == 0);
+    CHECK(dag.fan_in(*dag.find({6, 7})) == 2);
+    CHECK(dag.fan_in(*dag.find({14, 9})) == 0);
+    CHECK(dag.fan_out(*dag.find({14, 9})) == 0);
+    CHECK(dag.path_count(*dag.find({14, 9})) == 0);
+    CHECK(!dag.find({14, 10}).has_value());
+
+    CHECK(dag.activations() == 21);
     CHECK(part_1(test_input) == 21);
 
-    splitters.count_activations();
-    CHECK(splitters.counts.at({2, 7}) == 1);
-    CHECK(splitters.counts.at({2, 7}) == 1);
-    CHECK(splitters.counts.at({6, 7}) == 2);
-    CHECK(splitters.counts.at({14, 9}) == 0);
+    CHECK(dag.path_count(*dag.find({2, 7})) == 1);
+    CHECK(dag.path_count(*dag.find({4, 6})) == 1);
+    CHECK(dag.path_count(*dag.find({6, 7})) == 2);
 
-    std::vector<std::pair<int64_t, int64_t>> leaves = leaf_nodes(splitters);
-    UNUSED(leaves);
-    CHECK(leaves.size() == 7);
+    CHECK(dag.leaves().size() == 7);
 
     const std::string test_input_2 =
 	".......S.......\n"
@@ -188,20 +807,18 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 
     CHECK(part_1(test_input_2) == 3);
 
-    splitters = parse_input(test_input_2);
-    splitters.mark_activations();
-    splitters.count_activations();
+    dag = parse_input(test_input_2);
 
-    CHECK(count_children(splitters, std::pair<int64_t, int64_t>({2, 7})) == 2);
-    CHECK(count_children(splitters, std::pair<int64_t, int64_t>({5, 6})) == 0);
-    CHECK(count_children(splitters, std::pair<int64_t, int64_t>({5, 8})) == 0);
-    
-    leaves = leaf_nodes(splitters);
-    // printv(leaves);
-    CHECK(std::ranges::find(leaves, std::pair<int64_t, int64_t>({2, 7})) == leaves.end());
-    CHECK(std::ranges::find(leaves, std::pair<int64_t, int64_t>({5, 6})) != leaves.end());
-    CHECK(std::ranges::find(leaves, std::pair<int64_t, int64_t>({5, 8})) != leaves.end());
+    CHECK(dag.fan_out(*dag.find({2, 7})) == 2);
+    CHECK(dag.fan_out(*dag.find({5, 6})) == 0);
+    CHECK(dag.fan_out(*dag.find({5, 8})) == 0);
+
+    const std::vector<size_t> leaves = dag.leaves();
+    CHECK(std::ranges::find(leaves, *dag.find({2, 7})) == leaves.end());
+    CHECK(std::ranges::find(leaves, *dag.find({5, 6})) != leaves.end());
+    CHECK(std::ranges::find(leaves, *dag.find({5, 8})) != leaves.end());
 
+    CHECK(dag.timelines() == 4);
     CHECK(part_2(test_input_2) == 4);
 
 
@@ -218,10 +835,168 @@ void tests() // NOLINT(readability-function-cognitive-complexity)
 	"...............\n";
 
     CHECK(part_2(test_input_3) == ((1*2)+(3*2)+(3*1+(1*2))));
+    CHECK(parse_input(test_input_3).timelines() == part_2(test_input_3));
 
     
     CHECK(part_2(test_input) == 40);
-    
+    CHECK(parse_input(test_input).timelines() == 40);
+
+    // A million splitters: a staircase down the two left columns, whose
+    // beams stay within the first three, next to a lattice no beam reaches
+    std::string large_input = "S" + std::string(2002, '.') + "\n"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    constexpr size_t large_rows = 1000;
+    for (size_t i = 0; i < large_rows; i++) {
+	std::string row(2003, '.'); // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	row[i % 2] = SPLITTER_SYMBOL;
+	for (size_t col = 4; col < row.size(); col += 2) {
+	    row[col] = SPLITTER_SYMBOL;
+	}
+	large_input += row + "\n" + std::string(row.size(), '.') + "\n";
+    }
+    const SplitterDag large = parse_input(large_input);
+    CHECK(large.nodes.size() == large_rows * 1001);
+    CHECK(large.activations() == static_cast<Answer>(large_rows));
+    CHECK(large.activations() == sweep(large_input).activations);
+    CHECK(large.timelines() == sweep(large_input).timelines);
+    CHECK(large.leaves().size() == large.nodes.size() - large_rows + 1);
+
+    // Deep manifolds no longer recurse once per row
+    std::string tall_input = ".S.\n";
+    constexpr size_t tall_rows = 100000;
+    for (size_t i = 0; i < tall_rows; i++) {
+	tall_input += (i == tall_rows - 1) ? ".^.\n" : "...\n";
+    }
+    CHECK(sweep(tall_input).activations == 1);
+    CHECK(sweep(tall_input).timelines == 2);
+
+    // Word carries: splitters straddling 64-column boundaries, and beams
+    // leaving the manifold on both sides
+    std::string wide_input(130, '.');
+    wide_input[64] = SOURCE_SYMBOL;
+    wide_input += '\n';
+    for (const size_t col : {64, 63, 65, 62, 64, 66}) {
+	std::string row(130, '.');
+	row[col] = SPLITTER_SYMBOL;
+	wide_input += row + "\n" + std::string(130, '.') + "\n";
+    }
+    CHECK(bitboard_activations(wide_input) == sweep(wide_input).activations);
+    CHECK(lane_timelines(wide_input) == sweep(wide_input).timelines);
+    for (const auto& [width, col] : std::vector<std::pair<size_t, size_t>>({{130, 0}, {130, 129}, {128, 127}, {64, 63}, {65, 64}})) {
+	std::string edge_input(width, '.');
+	edge_input[col] = SOURCE_SYMBOL;
+	edge_input += '\n' + std::string(width, '.') + '\n';
+	edge_input[width + 1 + col] = SPLITTER_SYMBOL;
+	CHECK(bitboard_activations(edge_input) == 1);
+	CHECK(lane_timelines(edge_input) == 2);
+	CHECK(sweep(edge_input).timelines == 2);
+    }
+
+    // Sparse mode agrees with the dense sweep
+    for (const std::string& dense : {test_input, test_input_2, test_input_3, wide_input}) {
+	const SplitterDag graph = parse_input(dense);
+	const BeamSweep sparse = sparse_sweep({graph.limits.second, graph.source, graph.nodes});
+	CHECK(sparse.activations == sweep(dense).activations);
+	CHECK(sparse.timelines == sweep(dense).timelines);
+    }
+
+    const SparseManifold huge = parse_coordinates(
+	"4000000000,0,2000000000\n"
+	"2,2000000000\n"
+	"5,1999999999\n"
+	"5,2000000001\n"
+	"9,3999999999\n");
+    CHECK(huge.splitters.size() == 4);
+    CHECK(sparse_sweep(huge).activations == 3);
+    CHECK(sparse_sweep(huge).timelines == 4);
+    CHECK(sparse_sweep(parse_coordinates("10,3,9\n4,9\n")).timelines == 2);
+
+    {
+	const ScratchDir scratch;
+	const std::filesystem::path huge_path = scratch.path() / "huge.txt";
+	std::ofstream(huge_path) << "4000000000,0,2000000000\n2,2000000000\n5,1999999999\n5,2000000001\n9,3999999999\n";
+	CHECK(sparse_sweep_file(huge_path.string(), 1) == 3);
+	CHECK(sparse_sweep_file(huge_path.string(), 2) == 4);
+    }
+
+    // Coordinate files past the snapshot threshold are parsed once, then
+    // read back from the snapshot
+    {
+	const ScratchDir cache(true);
+	const std::filesystem::path wide_path = cache.path() / "wide.txt";
+	std::string wide_coordinates = "100000,0,50000\n";
+	for (int64_t row = 2; wide_coordinates.size() < MODEL_CACHE_MIN_BYTES; row += 2) {
+	    wide_coordinates += std::to_string(row) + "," + std::to_string(50000 + (row % 7) - 3) + "\n"; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	}
+	std::ofstream(wide_path) << wide_coordinates;
+	const BeamSweep expected = sparse_sweep(parse_coordinates(wide_coordinates));
+	CHECK(sparse_sweep_file(wide_path.string(), 2) == expected.timelines);
+	const auto is_snapshot = [](const std::filesystem::directory_entry& entry) -> bool {
+	    return entry.path().filename().string().starts_with("model-day7-0-");
+	};
+	CHECK(std::ranges::count_if(std::filesystem::directory_iterator(cache.path()), is_snapshot) == 1);
+	CHECK(sparse_sweep_file(wide_path.string(), 1) == expected.activations);
+	CHECK(sparse_sweep_file(wide_path.string(), 2) == expected.timelines);
+    }
+
+    const CacheKey key{7, 0, version(), 0};
+    ModelWriter writer;
+    encode_coordinates(huge, writer);
+    const std::string encoded = writer.encode(key);
+    const std::optional<ModelSnapshot> snapshot = ModelSnapshot::decode(nullptr, std::as_bytes(std::span(encoded)), key);
+    CHECK(snapshot && decode_coordinates(*snapshot).value().splitters == huge.splitters);
+
+    // One reverse pass answers every source column
+    const std::vector<Answer> all_sources = all_source_timelines(test_input);
+    CHECK(all_sources.size() == 15);
+    CHECK(all_sources[7] == 40);
+    for (size_t col = 0; col < all_sources.size(); col++) {
+	std::string moved = test_input;
+	moved[7] = '.';
+	moved[col] = SOURCE_SYMBOL;
+	CHECK(all_sources[col] == part_2(moved));
+    }
+
+    // Incremental edits match a full re-evaluation
+    IncrementalManifold manifold(test_input);
+    CHECK(manifold.activations() == 21);
+    CHECK(manifold.timelines() == 40);
+    const std::vector<std::tuple<size_t, size_t, bool>> edits = {
+	{2, 7, false}, {2, 7, true}, {3, 7, true}, {14, 9, false}, {14, 14, true},
+	{9, 0, true}, {1, 7, true}, {12, 6, false}, {15, 6, true}, {0, 3, true},
+    };
+    for (const auto& [row, col, present] : edits) {
+	manifold.set_splitter(row, col, present);
+	const std::string edited = manifold.to_string();
+	CHECK(manifold.activations() == part_1(edited));
+	CHECK(manifold.timelines() == part_2(edited));
+    }
+
+    // The edit command answers after every line, blank ones aside
+    std::istringstream edit_lines("2 7 .\n\n3 7 ^\n14 14 ^\n");
+    std::ostringstream edit_answers;
+    edit_manifold(test_input, edit_lines, edit_answers);
+    std::string edited = test_input;
+    std::string expected_answers = "21 40\n";
+    const std::vector<std::tuple<size_t, size_t, char>> edit_cells = {{2, 7, '.'}, {3, 7, '^'}, {14, 14, '^'}};
+    for (const auto& [row, col, symbol] : edit_cells) {
+	edited[(row * 16) + col] = symbol; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+	expected_answers += std::to_string(part_1(edited)) + " " + std::to_string(part_2(edited)) + "\n";
+    }
+    CHECK(edit_answers.str() == expected_answers);
+    for (const std::string malformed : {"2 7\n", "2 7 x\n", "2 7 ^ ^\n", "99 7 ^\n"}) {
+	std::istringstream bad_lines(malformed);
+	std::ostringstream ignored;
+	bool rejected = false;
+	try {
+	    edit_manifold(test_input, bad_lines, ignored);
+	} catch (std::runtime_error&) {
+	    rejected = true;
+	}
+	CHECK(rejected);
+    }
+
+    CHECK(bitboard_activations(test_input) == sweep(test_input).activations);
+    CHECK(lane_timelines(test_input_3) == sweep(test_input_3).timelines);
 }
 
 } // namespace day7
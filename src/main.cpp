@@ -1,18 +1,48 @@
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <optional>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "batch.hpp"
+#include "commands.hpp"
 #include "common.hpp"
 #include "days.hpp" // NOLINT(misc-include-cleaner)
+#include "parallel.hpp"
+#include "server.hpp"
+#include "simd.hpp"
 
 constexpr int MAX_DAY = 12;
 
+template <int N>
+auto run_day_batch(const BatchOptions& options) -> int {
+    Day<N> solver;
+    return run_batch(N,
+		     [&](const std::string& input) -> Answer { return solver.part_1(input); },
+		     [&](const std::string& input) -> Answer { return solver.part_2(input); },
+		     options);
+}
+
+template <int N>
+auto add_solvers(SolverTable& table) -> void {
+    const auto solver = std::make_shared<Day<N>>();
+    table.emplace(N, std::make_pair(
+		      [=](const std::string& input) -> Answer { return solver->part_1(input); },
+		      [=](const std::string& input) -> Answer { return solver->part_2(input); }));
+}
+
 template <int N,
 	  typename T = std::conditional_t<Day<N>::value, Day<N>, void>,
 	  typename U = std::conditional_t<Day<N + 1>::value, Day<N + 1>, void>>
@@ -21,30 +51,53 @@ struct RunnerImpl;
 template <int N>
 struct RunnerImpl<N, Day<N>, void> {
     // Base case
-    auto call(std::optional<int> day, std::optional<int> part) -> int { // NOLINT
+    auto call(std::optional<int> day, std::optional<int> part, const RunOptions& options) -> int { // NOLINT
 	if (!day || *day == N) {
-	    return Day<N>().run(part);
+	    return Day<N>().run(part, options);
 	}
 	return EXIT_SUCCESS;
     }
+    auto batch(int day, const BatchOptions& options) -> int {
+	return day == N ? run_day_batch<N>(options) : EXIT_SUCCESS;
+    }
+    auto solvers(SolverTable& table) -> void {
+	add_solvers<N>(table);
+    }
     auto match(int n) -> bool {
 	return n == N;
     }
+    auto paths(std::vector<std::string>& files) -> void {
+	Day<N> solver;
+	files.push_back(solver.input_path());
+	files.push_back(solver.answer_path(1));
+	files.push_back(solver.answer_path(2));
+    }
 };
 
 template <int N>
 struct RunnerImpl<N, Day<N>, Day<N+1>> {
     using Next = RunnerImpl<N + 1>;
-    auto call(std::optional<int> day, std::optional<int> part) -> int {
+    auto call(std::optional<int> day, std::optional<int> part, const RunOptions& options) -> int {
 	if (!day || *day == N) {
-	    Day<N>().run(part);
+	    Day<N>().run(part, options);
 	}
-	Next().call(day, part);
+	Next().call(day, part, options);
 	return EXIT_SUCCESS;
     }
+    auto batch(int day, const BatchOptions& options) -> int {
+	return day == N ? run_day_batch<N>(options) : Next().batch(day, options);
+    }
+    auto solvers(SolverTable& table) -> void {
+	add_solvers<N>(table);
+	Next().solvers(table);
+    }
     auto match(int n) -> bool {
 	return (n == N) || Next().match(n);
     }
+    auto paths(std::vector<std::string>& files) -> void {
+	RunnerImpl<N, Day<N>, void>().paths(files);
+	Next().paths(files);
+    }
 };
 
 template <int N>
@@ -79,39 +132,285 @@ auto get_args(std::span<char *> argv) -> std::pair<std::optional<int>, std::opti
 	return std::make_pair(day, part);
     }
 
-    throw std::runtime_error("Usage: " + std::string(argv[0]) + " [DAY] [PART]");
+    throw std::runtime_error("Usage: " + std::string(argv[0]) + " [DAY] [PART] [--tests] [--counters] [--threads N] [--isa NAME] | sources [COL...]"
+			     " | stream DAY PART [PATH]"
+			     " | sparse PART PATH"
+			     " | edit [PATH]"
+			     " | batch DAY PATH [--jsonl] [--jobs N] [--window N] [--part P]"
+			     " | serve SOCKET [--jobs N]"
+			     " | client SOCKET DAY PART PATH"
+			     " | loadtest SOCKET DAY PART PATH [REQUESTS] [CONNECTIONS]");
+}
+
+// aoc2025 batch DAY PATH [--jsonl] [--jobs N] [--window N] [--part P]
+// PATH is a directory of inputs or a manifest listing one input per line.
+auto get_batch_args(std::span<char *> argv) -> std::pair<int, BatchOptions>
+{
+    if (argv.size() < 4) {
+	throw std::runtime_error("Usage: " + std::string(argv[0])
+				 + " batch DAY PATH [--jsonl] [--jobs N] [--window N] [--part P]");
+    }
+
+    const int day = std::stoi(argv[2]);
+    BatchOptions options;
+    options.inputs = list_inputs(argv[3]);
+
+    for (size_t i = 4; i < argv.size(); i++) {
+	const std::string flag = argv[i];
+	if (flag == "--jsonl") {
+	    options.jsonl = true;
+	    continue;
+	}
+	if (i + 1 >= argv.size()) {
+	    throw std::runtime_error("Missing value for " + flag);
+	}
+	const std::string value = argv[++i];
+	if (flag == "--jobs") {
+	    options.jobs = std::stoull(value);
+	} else if (flag == "--window") {
+	    options.window = std::stoull(value);
+	} else if (flag == "--part") {
+	    options.part = std::stoi(value);
+	} else {
+	    throw std::runtime_error("Unknown option: " + flag);
+	}
+    }
+
+    return std::make_pair(day, options);
+}
+
+// aoc2025 serve SOCKET [--jobs N]
+// aoc2025 client SOCKET DAY PART PATH
+// aoc2025 loadtest SOCKET DAY PART PATH [REQUESTS] [CONNECTIONS]
+auto run_socket_command(std::span<char *> argv) -> int
+{
+    constexpr size_t DEFAULT_REQUESTS = 10000;
+    constexpr size_t DEFAULT_CONNECTIONS = 4;
+
+    const std::string command = argv[1];
+    if (command == "serve" && (argv.size() == 3 || (argv.size() == 5 && std::string(argv[3]) == "--jobs"))) {
+	SolverTable solvers;
+	Runner().solvers(solvers);
+	return run_server(argv[2], solvers, argv.size() == 5 ? std::stoull(argv[4]) : 0);
+    }
+    if (command == "client" && argv.size() == 6) {
+	return run_client(argv[2], std::stoi(argv[3]), std::stoi(argv[4]), argv[5]);
+    }
+    if (command == "loadtest" && argv.size() >= 6 && argv.size() <= 8) {
+	return run_load_test(argv[2], std::stoi(argv[3]), std::stoi(argv[4]), argv[5],
+			     argv.size() > 6 ? std::stoull(argv[6]) : DEFAULT_REQUESTS,
+			     argv.size() > 7 ? std::stoull(argv[7]) : DEFAULT_CONNECTIONS);
+    }
+    throw std::runtime_error("Usage: " + std::string(argv[0]) + " serve SOCKET [--jobs N]"
+			     " | client SOCKET DAY PART PATH"
+			     " | loadtest SOCKET DAY PART PATH [REQUESTS] [CONNECTIONS]");
+}
+
+auto check_args(Runner& runner, std::optional<int> day, std::optional<int> part) -> void
+{
+    if (day) {
+	if (*day < 1 || *day > MAX_DAY) {
+	    throw std::runtime_error(
+		"Invalid day: " + std::to_string(*day));
+	}
+	if (!runner.match(*day)) {
+	    throw std::runtime_error(
+		"Day " + std::to_string(*day) + " not implemented");
+	}
+    }
+
+    if (part) {
+	if (*part != 1 && *part != 2) {
+	    throw std::runtime_error(
+		"Invalid part: " + std::to_string(*part));
+	}
+    }
+}
+
+// aoc2025 sources [COL...]
+// Timeline counts of day 7 for the given source columns (all of them by
+// default), computed once from the day 7 input and answered by lookup.
+auto run_sources(std::span<char *> argv) -> int
+{
+    const std::vector<Answer> timelines = day7::all_source_timelines(Day<7>().load_input());
+
+    std::vector<size_t> columns;
+    std::transform(std::next(argv.begin(), 2), argv.end(), std::back_inserter(columns),
+		   [](const char *arg) -> size_t { return std::stoull(arg); });
+    if (columns.empty()) {
+	columns.resize(timelines.size());
+	std::iota(columns.begin(), columns.end(), 0);
+    }
+
+    for (const size_t col : columns) {
+	if (col >= timelines.size()) {
+	    throw std::runtime_error("Invalid column: " + std::to_string(col));
+	}
+	std::cout << col << " " << timelines[col] << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+// aoc2025 sparse PART PATH
+// Day 7 on a coordinate list of splitters, see day7::SparseManifold.
+auto run_sparse(std::span<char *> argv) -> int
+{
+    if (argv.size() != 4) {
+	throw std::runtime_error("Usage: " + std::string(argv[0]) + " sparse PART PATH");
+    }
+    const int part = std::stoi(argv[2]);
+    if (part != 1 && part != 2) {
+	throw std::runtime_error("Invalid part: " + std::to_string(part));
+    }
+    std::cout << day7::sparse_sweep_file(argv[3], part) << '\n';
+    return EXIT_SUCCESS;
+}
+
+// aoc2025 edit [PATH]
+// Day 7 on the manifold at PATH, the day 7 input by default, edited
+// interactively: standard input gives one "ROW COL ^" or "ROW COL ." per
+// line, and both answers are printed after each, see day7::edit_manifold.
+auto run_edit(std::span<char *> argv) -> int
+{
+    if (argv.size() > 3) {
+	throw std::runtime_error("Usage: " + std::string(argv[0]) + " edit [PATH]");
+    }
+    std::string input;
+    if (argv.size() == 3) {
+	std::ifstream file(argv[2], std::ios::binary);
+	if (!file) {
+	    throw std::runtime_error("Unable to open " + std::string(argv[2]));
+	}
+	input.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else {
+	input = Day<7>().load_input();
+    }
+    day7::edit_manifold(input, std::cin, std::cout);
+    return EXIT_SUCCESS;
+}
+
+// aoc2025 stream DAY PART [PATH]
+// Solve from a file, or standard input by default, in constant memory.
+// Day 6 reads each row of its worksheet through a stream of its own, so
+// it needs a file.
+auto run_stream(std::span<char *> argv) -> int
+{
+    if (argv.size() < 4 || argv.size() > 5) {
+	throw std::runtime_error("Usage: " + std::string(argv[0]) + " stream DAY PART [PATH]");
+    }
+    const int day = std::stoi(argv[2]);
+    const int part = std::stoi(argv[3]);
+    if (part != 1 && part != 2) {
+	throw std::runtime_error("Invalid part: " + std::to_string(part));
+    }
+
+    if (day == 6) {
+	if (argv.size() != 5 || std::string(argv[4]) == "-") {
+	    throw std::runtime_error("Day 6 streams from a file, not standard input");
+	}
+	std::cout << day6::stream_evaluate_file(argv[4], part == 2) << '\n';
+	return EXIT_SUCCESS;
+    }
+
+    const std::map<int, std::unique_ptr<StreamSolver> (*)(int)> solvers = {
+	{1, day1::stream_solver},
+	{3, day3::stream_solver},
+	{5, day5::stream_solver},
+    };
+    const auto solver = solvers.find(day);
+    if (solver == solvers.end()) {
+	throw std::runtime_error("Day " + std::to_string(day) + " has no streaming solver");
+    }
+
+    std::ifstream file;
+    if (argv.size() == 5 && std::string(argv[4]) != "-") {
+	file.open(argv[4], std::ios::binary);
+	if (!file) {
+	    throw std::runtime_error("Unable to open " + std::string(argv[4]));
+	}
+    }
+    std::istream& input = file.is_open() ? file : std::cin;
+    std::cout << solve_stream(input, *solver->second(part)) << '\n';
+    return EXIT_SUCCESS;
 }
 
 int main(int argc, char *argv[]) // NOLINT
 {
     try {
+	const std::span<char *> args_span(argv, argc);
+	if (args_span.size() >= 2 && std::string(args_span[1]) == "sources") {
+	    return run_sources(args_span);
+	}
+	if (args_span.size() >= 2 && std::string(args_span[1]) == "stream") {
+	    return run_stream(args_span);
+	}
+	if (args_span.size() >= 2 && std::string(args_span[1]) == "sparse") {
+	    return run_sparse(args_span);
+	}
+	if (args_span.size() >= 2 && std::string(args_span[1]) == "edit") {
+	    return run_edit(args_span);
+	}
+	if (args_span.size() >= 2
+	    && (std::string(args_span[1]) == "serve"
+		|| std::string(args_span[1]) == "client"
+		|| std::string(args_span[1]) == "loadtest")) {
+	    return run_socket_command(args_span);
+	}
+	if (args_span.size() >= 2 && std::string(args_span[1]) == "batch") {
+	    const auto [day, options] = get_batch_args(args_span);
+	    Runner runner;
+	    check_args(runner, day, options.part);
+	    return runner.batch(day, options);
+	}
+
+	// --tests also runs the runtime tests of every selected day;
+	// --counters reports hardware counters around each part;
+	// --threads N caps the threads of the parallel solvers, 1 for none;
+	// --isa NAME forces a variant of the vectorized kernels
+	RunOptions options;
+	std::vector<char *> plain_args;
+	for (size_t i = 0; i < args_span.size(); i++) {
+	    const std::string flag = args_span[i];
+	    if (flag == "--tests") {
+		options.tests = true;
+	    } else if (flag == "--counters") {
+		options.counters = true;
+	    } else if (flag == "--threads" && i + 1 < args_span.size()) {
+		set_parallel_threads(std::stoull(args_span[++i]));
+	    } else if (flag == "--isa" && i + 1 < args_span.size()) {
+		const std::string name = args_span[++i];
+		const std::optional<Isa> chosen = isa_from_name(name);
+		if (!chosen) {
+		    throw std::runtime_error("Unknown instruction set " + name + ", expected scalar, sse4.2, avx2 or avx512");
+		}
+		set_isa(*chosen);
+	    } else {
+		plain_args.push_back(args_span[i]);
+	    }
+	}
+
 	const std::pair<std::optional<int>,
 			std::optional<int>> args
-	    = get_args(std::span<char *>(argv, argc));
+	    = get_args(plain_args);
 
 	std::optional<int> day = args.first;
 	std::optional<int> part = args.second;
 
 	Runner runner;
+	check_args(runner, day, part);
 
-	if (day) {
-	    if (*day < 1 || *day > MAX_DAY) {
-		throw std::runtime_error(
-		    "Invalid day: " + std::to_string(*day));
-	    }
-	    if (!runner.match(*day)) {
-		throw std::runtime_error(
-		    "Day " + std::to_string(*day) + " not implemented");
-	    }
-	}
-
-	if (part) {
-	    if (*part != 1 && *part != 2) {
-		throw std::runtime_error(
-		    "Invalid part: " + std::to_string(*part));
+	// Every day in turn: the next inputs are read while a day computes
+	std::optional<Prefetcher> prefetch;
+	if (!day) {
+	    std::vector<std::string> files;
+	    runner.paths(files);
+	    std::erase_if(files, [](const std::string& file) -> bool { return embedded_file(file).has_value(); });
+	    if (!files.empty()) {
+		prefetch.emplace(std::move(files));
+		options.prefetch = &*prefetch;
 	    }
 	}
-	return runner.call(day, part);
+	return runner.call(day, part, options);
     } catch (const std::exception& e) {
 	std::cerr << "FATAL: Uncaught exception: " << e.what() << '\n';
 	return EXIT_FAILURE;
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string_view>
+
+#include <sys/resource.h>
+
+#include "common.hpp"
+
+namespace {
+
+// Process-wide, so that allocations on the prefetch, pool and pipeline
+// threads count too, and blocks freed on another thread than the one that
+// allocated them balance out. Relaxed: the counts need no ordering with
+// anything else.
+struct Counters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int64_t> live{0};
+    std::atomic<int64_t> peak{0};
+};
+
+constinit Counters counters;
+
+#ifdef AOC2025_MEMSTATS
+// Every block is prefixed with its size, so that unsized deletes can
+// still be accounted for. The header keeps the default new alignment.
+constexpr size_t HEADER = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+auto allocate(size_t size) -> void *
+{
+    void *block = std::malloc(size + HEADER); // NOLINT(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+    if (block == nullptr) {
+	throw std::bad_alloc();
+    }
+    std::memcpy(block, &size, sizeof(size));
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    const int64_t live = counters.live.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = counters.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char *>(block) + HEADER; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+auto release(void *ptr) -> void
+{
+    if (ptr == nullptr) {
+	return;
+    }
+    char *block = static_cast<char *>(ptr) - HEADER; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    size_t size = 0;
+    std::memcpy(&size, block, sizeof(size));
+    counters.live.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    std::free(block); // NOLINT(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+}
+#endif
+
+} // namespace
+
+#ifdef AOC2025_MEMSTATS
+// The nothrow and aligned forms keep their default definitions: the
+// former call these, the latter pair with each other.
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *ptr) noexcept { release(ptr); }
+void operator delete[](void *ptr) noexcept { release(ptr); }
+void operator delete(void *ptr, size_t /*size*/) noexcept { release(ptr); }
+void operator delete[](void *ptr, size_t /*size*/) noexcept { release(ptr); }
+#endif
+
+auto alloc_stats() -> AllocStats
+{
+    return {
+	counters.count.load(std::memory_order_relaxed),
+	counters.bytes.load(std::memory_order_relaxed),
+	counters.live.load(std::memory_order_relaxed),
+	counters.peak.load(std::memory_order_relaxed),
+    };
+}
+
+auto alloc_reset_peak() -> void
+{
+    counters.peak.store(counters.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// ru_maxrss is in kilobytes on Linux but in bytes on macOS
+auto peak_rss_kb() -> int64_t
+{
+    struct rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+MemoryPhase::MemoryPhase()
+{
+#ifdef AOC2025_MEMSTATS
+    alloc_reset_peak();
+    m_start = alloc_stats();
+    m_end = m_start;
+    m_rss_start = peak_rss_kb();
+    m_rss_end = m_rss_start;
+#endif
+}
+
+auto MemoryPhase::stop() -> void
+{
+#ifdef AOC2025_MEMSTATS
+    m_end = alloc_stats();
+    m_rss_end = peak_rss_kb();
+#endif
+}
+
+auto MemoryPhase::report(int day, std::string_view phase) const -> void
+{
+#ifdef AOC2025_MEMSTATS
+    std::cerr << R"({"day": )" << day
+	      << R"(, "phase": ")" << phase
+	      << R"(", "allocs": )" << m_end.count - m_start.count
+	      << R"(, "bytes": )" << m_end.bytes - m_start.bytes
+	      << R"(, "peak_live": )" << m_end.peak - m_start.live
+	      << R"(, "rss_delta_kb": )" << m_rss_end - m_rss_start
+	      << "}\n";
+#else
+    UNUSED(day);
+    UNUSED(phase);
+    UNUSED(m_rss_start);
+    UNUSED(m_rss_end);
+#endif
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace {
+
+using Task = std::function<void()>;
+
+// Every worker owns a deque: it pushes and pops its own tasks at the
+// back, so that it keeps working on the smallest and most recent split,
+// while idle workers steal the largest ones from the front. Threads
+// outside the pool push to a shared queue instead.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t n_workers);
+    ~ThreadPool() = default;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    void submit(Task task);
+
+    // Run one queued task, if any is found
+    bool run_one();
+
+private:
+    struct Queue {
+	std::mutex mutex;
+	std::deque<Task> tasks;
+    };
+
+    void work(const std::stop_token& stop, size_t idx);
+    std::optional<Task> take(std::optional<size_t> own);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    Queue m_shared;
+    std::atomic<size_t> m_queued{0};
+    std::mutex m_idle_mutex;
+    std::condition_variable_any m_idle;
+    std::vector<std::jthread> m_threads; // Last, so that they are joined first
+};
+
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(size_t n_workers)
+{
+    for (size_t i = 0; i < n_workers; i++) {
+	m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < n_workers; i++) {
+	m_threads.emplace_back([this, i](const std::stop_token& stop) -> void { work(stop, i); });
+    }
+}
+
+auto ThreadPool::submit(Task task) -> void
+{
+    if (current_pool == this) {
+	Queue& queue = *m_queues[current_worker];
+	const std::scoped_lock lock(queue.mutex);
+	queue.tasks.push_back(std::move(task));
+    } else {
+	const std::scoped_lock lock(m_shared.mutex);
+	m_shared.tasks.push_back(std::move(task));
+    }
+    {
+	// Counted under the idle lock so that no sleeping worker misses it
+	const std::scoped_lock lock(m_idle_mutex);
+	m_queued++;
+    }
+    m_idle.notify_one();
+}
+
+auto ThreadPool::take(std::optional<size_t> own) -> std::optional<Task>
+{
+    const auto pop = [this](Queue& queue, bool back) -> std::optional<Task> {
+	const std::scoped_lock lock(queue.mutex);
+	if (queue.tasks.empty()) {
+	    return {};
+	}
+	Task task;
+	if (back) {
+	    task = std::move(queue.tasks.back());
+	    queue.tasks.pop_back();
+	} else {
+	    task = std::move(queue.tasks.front());
+	    queue.tasks.pop_front();
+	}
+	m_queued--;
+	return task;
+    };
+
+    if (own) {
+	if (auto task = pop(*m_queues[*own], true)) {
+	    return task;
+	}
+    }
+    if (auto task = pop(m_shared, false)) {
+	return task;
+    }
+    const size_t start = own ? *own + 1 : 0;
+    for (size_t i = 0; i < m_queues.size(); i++) {
+	if (auto task = pop(*m_queues[(start + i) % m_queues.size()], false)) {
+	    return task;
+	}
+    }
+    return {};
+}
+
+auto ThreadPool::run_one() -> bool
+{
+    std::optional<Task> task = take(current_pool == this ? std::optional<size_t>(current_worker) : std::nullopt);
+    if (!task) {
+	return false;
+    }
+    (*task)();
+    return true;
+}
+
+auto ThreadPool::work(const std::stop_token& stop, size_t idx) -> void
+{
+    current_pool = this;
+    current_worker = idx;
+    while (!stop.stop_requested()) {
+	if (!run_one()) {
+	    std::unique_lock lock(m_idle_mutex);
+	    m_idle.wait(lock, stop, [this]() -> bool { return m_queued > 0; });
+	}
+    }
+}
+
+std::mutex pool_mutex;
+std::atomic<size_t> requested_threads{0};
+std::shared_ptr<ThreadPool> shared_pool;
+
+// Workers are one fewer than the threads, the caller being the last one
+auto pool() -> std::shared_ptr<ThreadPool>
+{
+    const std::scoped_lock lock(pool_mutex);
+    if (!shared_pool) {
+	shared_pool = std::make_shared<ThreadPool>(parallel_threads() - 1);
+    }
+    return shared_pool;
+}
+
+struct ForState {
+    ThreadPool& workers;
+    const std::function<void(size_t, size_t)>& body;
+    size_t n;
+    size_t n_chunks;
+    std::atomic<size_t> remaining;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+// The chunk range is split in halves, the upper half going to the deque
+// each time, so that a thief takes half of what is left in one go.
+auto run_chunks(ForState& state, size_t first, size_t last) -> void
+{
+    while (last - first > 1) {
+	const size_t mid = first + ((last - first) / 2);
+	state.workers.submit([&state, mid, last]() -> void { run_chunks(state, mid, last); });
+	last = mid;
+    }
+    try {
+	state.body(state.n * first / state.n_chunks, state.n * (first + 1) / state.n_chunks);
+    } catch (...) {
+	const std::scoped_lock lock(state.error_mutex);
+	if (!state.error) {
+	    state.error = std::current_exception();
+	}
+    }
+    // Last use of state: the caller may return as soon as this reaches 0
+    state.remaining--;
+}
+
+} // namespace
+
+auto set_parallel_threads(size_t threads) -> void
+{
+    // The previous pool is joined once the lock is released
+    std::shared_ptr<ThreadPool> previous;
+    {
+	const std::scoped_lock lock(pool_mutex);
+	requested_threads = threads;
+	previous = std::move(shared_pool);
+    }
+}
+
+auto parallel_threads() -> size_t
+{
+    const size_t threads = requested_threads;
+    return threads != 0 ? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+ScopedThreads::ScopedThreads(size_t threads)
+    : m_previous{requested_threads}
+{
+    set_parallel_threads(threads);
+}
+
+ScopedThreads::~ScopedThreads()
+{
+    set_parallel_threads(m_previous);
+}
+
+auto parallel_chunks(size_t n, size_t min_grain) -> size_t
+{
+    const size_t threads = parallel_threads();
+    if (threads <= 1) {
+	return 1;
+    }
+    return std::clamp<size_t>(n / std::max<size_t>(min_grain, 1), 1, threads * CHUNKS_PER_THREAD);
+}
+
+auto parallel_for(size_t n, const std::function<void(size_t, size_t)>& body, size_t min_grain) -> void
+{
+    const size_t n_chunks = parallel_chunks(n, min_grain);
+    if (n_chunks == 1) {
+	body(0, n);
+	return;
+    }
+
+    const std::shared_ptr<ThreadPool> workers = pool();
+    ForState state{*workers, body, n, n_chunks, n_chunks, {}, {}};
+    run_chunks(state, 0, n_chunks);
+    while (state.remaining > 0) {
+	if (!workers->run_one()) {
+	    std::this_thread::yield();
+	}
+    }
+    if (state.error) {
+	std::rethrow_exception(state.error);
+    }
+}
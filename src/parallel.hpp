@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Data-parallel helpers over a shared work-stealing pool. Work is cut
+// into chunks of at least min_grain items, and into about
+// CHUNKS_PER_THREAD chunks per thread when there is enough of it, so that
+// stealing evens out uneven items. With one thread everything runs
+// inline on the caller, in order.
+constexpr size_t CHUNKS_PER_THREAD = 8;
+
+// Threads used by the helpers, the caller included; 0 means one per
+// hardware thread. The pool is rebuilt on the next call.
+void set_parallel_threads(size_t threads);
+size_t parallel_threads();
+
+// Sets the thread count for its lifetime, then puts back the one asked
+// for before it, even when an exception leaves the scope
+class ScopedThreads {
+public:
+    explicit ScopedThreads(size_t threads);
+    ~ScopedThreads();
+    ScopedThreads(const ScopedThreads&) = delete;
+    ScopedThreads(ScopedThreads&&) = delete;
+    ScopedThreads& operator=(const ScopedThreads&) = delete;
+    ScopedThreads& operator=(ScopedThreads&&) = delete;
+
+private:
+    size_t m_previous;
+};
+
+// Number of chunks [0, n) is cut into
+size_t parallel_chunks(size_t n, size_t min_grain = 1);
+
+// Call body(first, last) on every chunk of [0, n), in parallel. The first
+// exception thrown by a chunk is rethrown once all chunks are done.
+void parallel_for(size_t n, const std::function<void(size_t, size_t)>& body, size_t min_grain = 1);
+
+// Fold of map(first, last) over the chunks of [0, n), combined in chunk
+// order starting from init. combine must be associative for the result
+// not to depend on the thread count.
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(size_t n, T init, Map map, Combine combine, size_t min_grain = 1)
+{
+    const size_t n_chunks = parallel_chunks(n, min_grain);
+    std::vector<T> partial(n_chunks, init);
+    parallel_for(n_chunks, [&](size_t first, size_t last) -> void {
+	for (size_t chunk = first; chunk < last; chunk++) {
+	    partial[chunk] = map(n * chunk / n_chunks, n * (chunk + 1) / n_chunks);
+	}
+    });
+    T result = init;
+    for (const T& value : partial) {
+	result = combine(result, value);
+    }
+    return result;
+}
+
+// Chunks are sorted in parallel, then merged pairwise in parallel rounds
+template <typename T, typename Compare = std::less<>>
+void parallel_sort(std::vector<T>& values, Compare comp = {}, size_t min_grain = 4096)
+{
+    const size_t n = values.size();
+    const size_t n_chunks = parallel_chunks(n, min_grain);
+    const auto bound = [&](size_t chunk) -> typename std::vector<T>::iterator {
+	return values.begin() + static_cast<std::ptrdiff_t>(n * std::min(chunk, n_chunks) / n_chunks);
+    };
+
+    parallel_for(n_chunks, [&](size_t first, size_t last) -> void {
+	for (size_t chunk = first; chunk < last; chunk++) {
+	    std::sort(bound(chunk), bound(chunk + 1), comp);
+	}
+    });
+    for (size_t width = 1; width < n_chunks; width *= 2) {
+	const size_t n_merges = (n_chunks + (2 * width) - 1) / (2 * width);
+	parallel_for(n_merges, [&](size_t first, size_t last) -> void {
+	    for (size_t merge = first; merge < last; merge++) {
+		const size_t left = merge * 2 * width;
+		std::inplace_merge(bound(left), bound(left + width), bound(left + (2 * width)), comp);
+	    }
+	});
+    }
+}
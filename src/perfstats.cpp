@@ -0,0 +1,202 @@
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common.hpp"
+
+namespace {
+
+struct Event {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+enum EventIndex : uint8_t { CYCLES, INSTRUCTIONS, CACHE_REFERENCES, CACHE_MISSES, BRANCH_MISSES, PAGE_FAULTS };
+
+#ifdef __linux__
+constexpr std::array<Event, 6> EVENTS = {{
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+}};
+
+// User-space only, so that a perf_event_paranoid of 2 is enough. The
+// first event opened leads the group, which is enabled and disabled as a
+// whole so that every counter covers the same instructions. Inherited
+// events also count the threads the caller starts once they are open,
+// such as pool workers and pipeline stages, and read back their sum.
+auto open_event(const Event& event, int leader, bool inherit) -> int
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = leader < 0 ? 1 : 0;
+    attr.inherit = inherit ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0)); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+}
+#endif
+
+auto format_ratio(std::optional<uint64_t> num, std::optional<double> den) -> std::string
+{
+    if (!num || !den || *den == 0) {
+	return "null";
+    }
+    std::stringstream ratio;
+    ratio << std::setprecision(4) << static_cast<double>(*num) / *den; // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    return ratio.str();
+}
+
+#ifdef __linux__
+auto format_count(std::optional<uint64_t> count) -> std::string
+{
+    return count ? std::to_string(*count) : "null";
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters(bool enabled)
+    : m_enabled{enabled}
+{
+    if (!m_enabled) {
+	return;
+    }
+#ifdef __linux__
+    // Without inherited events only the calling thread is counted
+    for (const bool inherit : {true, false}) {
+	int leader = -1;
+	for (const Event& event : EVENTS) {
+	    const int fd = open_event(event, leader, inherit);
+	    if (fd < 0 && m_error.empty()) {
+		m_error = std::string(event.name) + ": " + std::strerror(errno); // NOLINT(concurrency-mt-unsafe)
+	    }
+	    if (fd >= 0 && leader < 0) {
+		leader = fd;
+	    }
+	    m_fds.push_back(fd);
+	}
+	if (leader >= 0) {
+	    m_error.clear();
+	    m_inherit = inherit;
+	    break;
+	}
+	m_fds.clear();
+    }
+    m_values.resize(m_fds.size());
+#else
+    m_error = "perf_event_open is Linux only";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (const int fd : m_fds) {
+	if (fd >= 0) {
+	    ::close(fd);
+	}
+    }
+#endif
+}
+
+auto PerfCounters::start() -> void
+{
+#ifdef __linux__
+    for (const int fd : m_fds) {
+	if (fd >= 0) {
+	    ::ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+	    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+	    return;
+	}
+    }
+#endif
+}
+
+auto PerfCounters::stop() -> void
+{
+#ifdef __linux__
+    for (const int fd : m_fds) {
+	if (fd >= 0) {
+	    ::ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+	    break;
+	}
+    }
+    for (size_t i = 0; i < m_fds.size(); i++) {
+	uint64_t value = 0;
+	if (m_fds[i] >= 0 && ::read(m_fds[i], &value, sizeof(value)) == sizeof(value)) {
+	    m_values[i] = value;
+	} else {
+	    m_values[i].reset();
+	}
+    }
+#endif
+}
+
+// One JSON line on stderr, next to the MemoryPhase ones
+auto PerfCounters::report(int day, std::string_view phase, size_t input_bytes) const -> void
+{
+    if (!m_enabled) {
+	return;
+    }
+    if (!m_error.empty()) {
+	static bool warned = false;
+	if (!warned) {
+	    std::cerr << "Counters unavailable (" << m_error << "), see /proc/sys/kernel/perf_event_paranoid\n";
+	    warned = true;
+	}
+	return;
+    }
+
+    const auto value = [&](EventIndex idx) -> std::optional<uint64_t> { return m_values.at(idx); };
+    const std::optional<double> bytes = static_cast<double>(input_bytes);
+    const std::optional<uint64_t> cycles = value(CYCLES);
+
+    std::cerr << R"({"day": )" << day << R"(, "phase": ")" << phase << '"'
+	      << R"(, "threads": ")" << (m_inherit ? "caller_and_started" : "caller_only") << '"';
+#ifdef __linux__
+    for (size_t i = 0; i < m_values.size(); i++) {
+	std::cerr << R"(, ")" << EVENTS.at(i).name << R"(": )" << format_count(m_values[i]);
+    }
+#endif
+    std::cerr << R"(, "ipc": )"
+	      << format_ratio(value(INSTRUCTIONS), cycles ? std::optional<double>(*cycles) : std::nullopt)
+	      << R"(, "cache_misses_per_byte": )" << format_ratio(value(CACHE_MISSES), bytes)
+	      << R"(, "branch_misses_per_byte": )" << format_ratio(value(BRANCH_MISSES), bytes)
+	      << "}\n";
+}
+
+auto PerfCounters::count(std::string_view event) const -> std::optional<uint64_t>
+{
+#ifdef __linux__
+    for (size_t i = 0; i < m_values.size(); i++) {
+	if (EVENTS.at(i).name == event) {
+	    return m_values[i];
+	}
+    }
+#else
+    UNUSED(event);
+#endif
+    return {};
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Two-stage pipelines: the caller parses records and pushes them in
+// batches through a bounded ring, while a worker thread folds them in
+// order. A full ring stalls the parser until the worker catches up, so
+// that at most PIPELINE_DEPTH batches of PIPELINE_BATCH records are in
+// flight whatever the length of the input.
+constexpr size_t PIPELINE_BATCH = 4096;
+constexpr size_t PIPELINE_DEPTH = 16;
+
+// Keeps the two ends of a ring on separate cache lines
+constexpr size_t CACHE_LINE = 64;
+
+// Lock-free ring between one producer and one consumer. Either side
+// sleeps on the other's index while the ring is full or empty, and
+// either side can close it: the consumer still drains what was pushed
+// before the producer closed it, while the producer drops anything
+// pushed after the consumer closed it.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(std::has_single_bit(N));
+
+public:
+    // Producer side: false if the consumer closed the ring
+    bool push(T value);
+    void close_push();
+
+    // Consumer side: nullopt once the producer closed the ring and it is
+    // empty
+    std::optional<T> pop();
+    void close_pop();
+
+private:
+    static constexpr size_t CLOSED = size_t{1} << (std::numeric_limits<size_t>::digits - 1);
+
+    std::array<T, N> m_slots{};
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0}; // Next slot to pop, written by the consumer
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0}; // Next slot to push, written by the producer
+};
+
+template <typename T, size_t N>
+bool SpscRing<T, N>::push(T value)
+{
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
+    while ((head & CLOSED) == 0 && tail - head == N) {
+	m_head.wait(head, std::memory_order_acquire);
+	head = m_head.load(std::memory_order_acquire);
+    }
+    if ((head & CLOSED) != 0) {
+	return false;
+    }
+    m_slots[tail % N] = std::move(value);
+    m_tail.store(tail + 1, std::memory_order_release);
+    m_tail.notify_one();
+    return true;
+}
+
+template <typename T, size_t N>
+void SpscRing<T, N>::close_push()
+{
+    m_tail.fetch_or(CLOSED, std::memory_order_release);
+    m_tail.notify_one();
+}
+
+template <typename T, size_t N>
+std::optional<T> SpscRing<T, N>::pop()
+{
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    while ((tail & ~CLOSED) == head) {
+	if ((tail & CLOSED) != 0) {
+	    return {};
+	}
+	m_tail.wait(tail, std::memory_order_acquire);
+	tail = m_tail.load(std::memory_order_acquire);
+    }
+    std::optional<T> value = std::move(m_slots[head % N]);
+    m_head.store(head + 1, std::memory_order_release);
+    m_head.notify_one();
+    return value;
+}
+
+template <typename T, size_t N>
+void SpscRing<T, N>::close_pop()
+{
+    m_head.fetch_or(CLOSED, std::memory_order_release);
+    m_head.notify_one();
+}
+
+// The fold runs on the worker, one batch at a time. Whatever it folds
+// into must outlive the pipeline: declare the pipeline after it, so that
+// the worker is joined first.
+template <typename Record>
+class Pipeline {
+public:
+    using Fold = std::function<void(std::span<const Record>)>;
+
+    explicit Pipeline(Fold fold, size_t batch = PIPELINE_BATCH);
+    ~Pipeline() { m_ring.close_push(); }
+    Pipeline(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline& operator=(Pipeline&&) = delete;
+
+    void push(Record record);
+
+    // Fold what is left and wait for the worker. The first exception
+    // thrown by the fold is rethrown here; records pushed after it are
+    // dropped.
+    void finish();
+
+private:
+    void work();
+
+    Fold m_fold;
+    size_t m_batch_size;
+    std::vector<Record> m_batch;
+    SpscRing<std::vector<Record>, PIPELINE_DEPTH> m_ring;
+    std::exception_ptr m_error;
+    std::jthread m_worker; // Last, so that it is joined first
+};
+
+template <typename Record>
+Pipeline<Record>::Pipeline(Fold fold, size_t batch)
+    : m_fold{std::move(fold)}, m_batch_size{std::max<size_t>(batch, 1)}, m_worker{[this]() -> void { work(); }}
+{
+    m_batch.reserve(m_batch_size);
+}
+
+template <typename Record>
+void Pipeline<Record>::push(Record record)
+{
+    m_batch.push_back(std::move(record));
+    if (m_batch.size() == m_batch_size) {
+	m_ring.push(std::exchange(m_batch, {}));
+	m_batch.reserve(m_batch_size);
+    }
+}
+
+template <typename Record>
+void Pipeline<Record>::finish()
+{
+    if (!m_batch.empty()) {
+	m_ring.push(std::exchange(m_batch, {}));
+    }
+    m_ring.close_push();
+    if (m_worker.joinable()) {
+	m_worker.join();
+    }
+    if (m_error) {
+	std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+}
+
+template <typename Record>
+void Pipeline<Record>::work()
+{
+    while (std::optional<std::vector<Record>> batch = m_ring.pop()) {
+	try {
+	    m_fold(*batch);
+	} catch (...) {
+	    m_error = std::current_exception();
+	    m_ring.close_pop();
+	    return;
+	}
+    }
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.hpp"
+
+struct PrefetchState {
+    struct Entry {
+	std::string path;
+	std::optional<std::string> contents;
+	bool done{false};
+    };
+
+    std::vector<Entry> entries;
+    size_t budget{0};
+    size_t held{0}; // Bytes read and not taken yet
+    size_t taken{0}; // Entries before this one are no longer wanted
+    std::mutex mutex;
+    std::condition_variable_any changed;
+    std::jthread reader; // Last, so that it is joined first
+};
+
+namespace {
+
+// Start the kernel reading the whole file now, without holding any of it
+// here. Systems without posix_fadvise only get the reader thread.
+auto advise_willneed(const std::string& path) -> void
+{
+#ifdef POSIX_FADV_WILLNEED
+    const int fd = ::open(path.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+    if (fd >= 0) {
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	::close(fd);
+    }
+#else
+    UNUSED(path);
+#endif
+}
+
+auto read_file(const std::string& path, size_t size) -> std::optional<std::string>
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+	return {};
+    }
+    std::string contents(size, '\0');
+    file.read(contents.data(), static_cast<std::streamsize>(size));
+    contents.resize(static_cast<size_t>(file.gcount()));
+    return contents;
+}
+
+auto read_ahead(const std::stop_token& stop, PrefetchState& state) -> void
+{
+    for (const PrefetchState::Entry& entry : state.entries) {
+	advise_willneed(entry.path);
+    }
+
+    for (size_t idx = 0; idx < state.entries.size(); idx++) {
+	const std::string& path = state.entries[idx].path;
+	std::error_code err;
+	const size_t size = std::filesystem::file_size(path, err);
+	{
+	    // A file larger than the whole budget still goes through alone
+	    std::unique_lock lock(state.mutex);
+	    if (!state.changed.wait(lock, stop, [&]() -> bool {
+		return idx < state.taken || state.held == 0 || state.held + size <= state.budget;
+	    })) {
+		return;
+	    }
+	    if (idx < state.taken) {
+		continue;
+	    }
+	}
+
+	std::optional<std::string> contents;
+	if (!err) {
+	    contents = read_file(path, size);
+	}
+
+	const std::scoped_lock lock(state.mutex);
+	PrefetchState::Entry& entry = state.entries[idx];
+	if (idx >= state.taken && contents) {
+	    state.held += contents->size();
+	    entry.contents = std::move(contents);
+	}
+	entry.done = true;
+	state.changed.notify_all();
+    }
+}
+
+} // namespace
+
+Prefetcher::Prefetcher(std::vector<std::string> paths, size_t budget)
+    : m_state{std::make_unique<PrefetchState>()}
+{
+    std::ranges::transform(paths, std::back_inserter(m_state->entries),
+			   [](std::string& path) -> PrefetchState::Entry { return {std::move(path), {}, false}; });
+    m_state->budget = budget;
+    m_state->reader = std::jthread([state = m_state.get()](const std::stop_token& stop) -> void {
+	read_ahead(stop, *state);
+    });
+}
+
+Prefetcher::~Prefetcher() = default;
+
+auto Prefetcher::take(const std::string& path) -> std::optional<std::string>
+{
+    PrefetchState& state = *m_state;
+    std::unique_lock lock(state.mutex);
+    const auto begin = std::next(state.entries.begin(), static_cast<std::ptrdiff_t>(state.taken));
+    const auto found = std::find_if(begin, state.entries.end(),
+				    [&](const PrefetchState::Entry& entry) -> bool { return entry.path == path; });
+    if (found == state.entries.end()) {
+	return {};
+    }
+
+    // Whatever was skipped makes room for what comes next
+    const auto idx = static_cast<size_t>(std::distance(state.entries.begin(), found));
+    for (; state.taken < idx; state.taken++) {
+	std::optional<std::string>& skipped = state.entries[state.taken].contents;
+	if (skipped) {
+	    state.held -= skipped->size();
+	    skipped.reset();
+	}
+    }
+    state.changed.notify_all();
+
+    state.changed.wait(lock, [&]() -> bool { return found->done; });
+    std::optional<std::string> contents = std::exchange(found->contents, std::nullopt);
+    if (contents) {
+	state.held -= contents->size();
+    }
+    state.taken = idx + 1;
+    state.changed.notify_all();
+    return contents;
+}
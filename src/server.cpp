@@ -0,0 +1,581 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "common.hpp"
+#include "server.hpp"
+
+namespace {
+
+constexpr int LISTEN_BACKLOG = 128;
+constexpr size_t READ_CHUNK = 65536;
+constexpr size_t MAX_LINE = 65536;
+constexpr size_t MAX_INLINE_INPUT = 256 * 1024 * 1024;
+
+auto sys_error(const std::string& what) -> std::system_error
+{
+    return {errno, std::generic_category(), what};
+}
+
+auto socket_address(const std::string& path) -> sockaddr_un
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+	throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::ranges::copy(path, std::begin(addr.sun_path));
+    return addr;
+}
+
+auto connect_to(const std::string& path) -> int
+{
+    const sockaddr_un addr = socket_address(path);
+    const int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+	throw sys_error("socket");
+    }
+    if (::connect(sock, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	::close(sock);
+	throw sys_error("connect " + path);
+    }
+    return sock;
+}
+
+auto set_nonblocking(int sock) -> void
+{
+    const int flags = ::fcntl(sock, F_GETFL); // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+    if (flags < 0 || ::fcntl(sock, F_SETFL, flags | O_NONBLOCK) != 0) { // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-vararg,hicpp-signed-bitwise)
+	throw sys_error("fcntl");
+    }
+}
+
+auto read_file(const std::string& path) -> std::string
+{
+    std::ifstream ifile(path, std::ios::binary);
+    if (!ifile) {
+	throw std::runtime_error("Unable to open " + path);
+    }
+    return {std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()};
+}
+
+// Buffered reads and full writes over a connected socket
+class Connection {
+public:
+    explicit Connection(int sock) : m_sock{sock} {}
+    ~Connection() { ::close(m_sock); }
+    Connection(const Connection&) = delete;
+    Connection(Connection&&) = delete;
+    auto operator=(const Connection&) -> Connection& = delete;
+    auto operator=(Connection&&) -> Connection& = delete;
+
+    // False on a clean end of stream; lines are at most MAX_LINE bytes
+    auto read_line(std::string& line) -> bool;
+    auto write_all(std::string_view data) -> void;
+
+private:
+    auto fill() -> bool;
+
+    int m_sock;
+    std::string m_buf;
+    size_t m_pos{0};
+};
+
+auto Connection::fill() -> bool
+{
+    m_buf.erase(0, m_pos);
+    m_pos = 0;
+    const size_t old_size = m_buf.size();
+    m_buf.resize(old_size + READ_CHUNK);
+    ssize_t got = 0;
+    do { // NOLINT(cppcoreguidelines-avoid-do-while)
+	got = ::read(m_sock, std::next(m_buf.data(), static_cast<std::ptrdiff_t>(old_size)), READ_CHUNK);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) {
+	throw sys_error("read");
+    }
+    m_buf.resize(old_size + static_cast<size_t>(got));
+    return got > 0;
+}
+
+auto Connection::read_line(std::string& line) -> bool
+{
+    size_t newline = 0;
+    while ((newline = m_buf.find('\n', m_pos)) == std::string::npos) {
+	if (m_buf.size() - m_pos > MAX_LINE) {
+	    throw std::runtime_error("Line over " + std::to_string(MAX_LINE) + " bytes");
+	}
+	if (!fill()) {
+	    if (m_pos < m_buf.size()) {
+		throw std::runtime_error("Truncated request");
+	    }
+	    return false;
+	}
+    }
+    line.assign(m_buf, m_pos, newline - m_pos);
+    m_pos = newline + 1;
+    return true;
+}
+
+auto Connection::write_all(std::string_view data) -> void
+{
+    while (!data.empty()) {
+	const ssize_t sent = ::write(m_sock, data.data(), data.size());
+	if (sent < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    throw sys_error("write");
+	}
+	data.remove_prefix(static_cast<size_t>(sent));
+    }
+}
+
+auto solve(const SolverTable& solvers, int day, int part, const std::string& input) -> std::string
+{
+    const auto solver = solvers.find(day);
+    if (solver == solvers.end()) {
+	return "ERR Day " + std::to_string(day) + " not implemented\n";
+    }
+    if (part != 1 && part != 2) {
+	return "ERR Invalid part: " + std::to_string(part) + "\n";
+    }
+    try {
+	const Answer answer = part == 1 ? solver->second.first(input) : solver->second.second(input);
+	return "OK " + std::to_string(answer) + "\n";
+    } catch (NotImplemented&) {
+	return "ERR Not Implemented\n";
+    } catch (const std::exception& e) {
+	return "ERR " + std::string(e.what()) + "\n";
+    }
+}
+
+// A request taken off a connection, for the workers. Its reply goes back
+// to the event loop, keyed by the connection.
+struct Job {
+    uint64_t client{0};
+    int day{0};
+    int part{0};
+    bool inline_input{false};
+    std::string data; // The input, or the path to read it from
+};
+
+struct Completion {
+    uint64_t client;
+    std::string reply;
+};
+
+auto run_job(const SolverTable& solvers, const Job& job) -> std::string
+{
+    if (job.inline_input) {
+	return solve(solvers, job.day, job.part, job.data);
+    }
+    try {
+	return solve(solvers, job.day, job.part, read_file(job.data));
+    } catch (const std::exception& e) {
+	return "ERR " + std::string(e.what()) + "\n";
+    }
+}
+
+// Server side of a connection, driven by the event loop. Requests are cut
+// from what was read so far and handed to the workers one at a time, so
+// that replies go out in request order; the socket is not read meanwhile.
+struct Client {
+    explicit Client(int sock) : sock{sock} {}
+
+    int sock;
+    std::string in;
+    std::optional<Job> header; // Request line read, inline input pending
+    size_t body_size{0};
+    std::string out; // Replies not written yet
+    bool busy{false}; // A request is with the workers
+    bool eof{false}; // No more requests will come
+};
+
+// The reply is the last thing written: the connection is closed after it
+auto reject(Client& client, const std::string& reply) -> void
+{
+    client.out += reply;
+    client.in.clear();
+    client.header.reset();
+    client.eof = true;
+}
+
+// Next complete request of the connection, if it has one
+auto next_job(Client& client, uint64_t id) -> std::optional<Job>
+{
+    if (!client.header) {
+	const size_t newline = client.in.find('\n');
+	if (newline == std::string::npos) {
+	    if (client.in.size() > MAX_LINE) {
+		reject(client, "ERR Request line over " + std::to_string(MAX_LINE) + " bytes\n");
+	    }
+	    return {};
+	}
+	std::istringstream line(client.in.substr(0, newline));
+	client.in.erase(0, newline + 1);
+	Job job;
+	job.client = id;
+	std::string mode;
+	line >> job.day >> job.part >> mode;
+	if (mode == "path") {
+	    std::getline(line >> std::ws, job.data);
+	    return job;
+	}
+	size_t size = 0;
+	if (mode != "bytes" || !(line >> size)) {
+	    reject(client, "ERR Malformed request\n");
+	    return {};
+	}
+	if (size > MAX_INLINE_INPUT) {
+	    reject(client, "ERR Inline input over " + std::to_string(MAX_INLINE_INPUT) + " bytes\n");
+	    return {};
+	}
+	job.inline_input = true;
+	client.header = std::move(job);
+	client.body_size = size;
+    }
+    if (client.in.size() < client.body_size) {
+	return {};
+    }
+    Job job = std::move(*client.header);
+    client.header.reset();
+    job.data.assign(client.in, 0, client.body_size);
+    client.in.erase(0, client.body_size);
+    return job;
+}
+
+// False once the connection is gone
+auto read_some(Client& client, std::span<char> chunk) -> bool
+{
+    const ssize_t got = ::read(client.sock, chunk.data(), chunk.size());
+    if (got < 0) {
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+	    return true;
+	}
+	std::cerr << "Connection dropped: " << std::strerror(errno) << '\n'; // NOLINT(concurrency-mt-unsafe)
+	return false;
+    }
+    if (got == 0) {
+	client.eof = true;
+	return true;
+    }
+    client.in.append(chunk.data(), static_cast<size_t>(got));
+    return true;
+}
+
+// False once the connection is gone
+auto write_some(Client& client) -> bool
+{
+    while (!client.out.empty()) {
+	const ssize_t sent = ::write(client.sock, client.out.data(), client.out.size());
+	if (sent < 0) {
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		return true;
+	    }
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return false;
+	}
+	client.out.erase(0, static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+auto percentile(const std::vector<double>& sorted, double fraction) -> double
+{
+    const auto rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1));
+    return sorted.at(rank);
+}
+
+} // namespace
+
+auto run_server(const std::string& socket_path, const SolverTable& solvers, size_t jobs) -> int
+{
+    (void)std::signal(SIGPIPE, SIG_IGN); // NOLINT(cert-err33-c)
+    jobs = jobs != 0 ? jobs : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    const sockaddr_un addr = socket_address(socket_path);
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+	throw sys_error("socket");
+    }
+    std::filesystem::remove(socket_path);
+    if (::bind(listener, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	|| ::listen(listener, LISTEN_BACKLOG) != 0) {
+	::close(listener);
+	throw sys_error("listen " + socket_path);
+    }
+
+    set_nonblocking(listener);
+
+    // Workers write a byte to the pipe for every completion they post
+    std::array<int, 2> wake{};
+    if (::pipe(wake.data()) != 0) {
+	throw sys_error("pipe");
+    }
+    set_nonblocking(wake[0]);
+    set_nonblocking(wake[1]);
+
+    std::mutex mutex;
+    std::condition_variable_any ready;
+    std::queue<Job> jobs_pending;
+    std::vector<Completion> completed;
+    std::vector<std::jthread> pool;
+    pool.reserve(jobs);
+    for (size_t i = 0; i < jobs; i++) {
+	pool.emplace_back([&](const std::stop_token& stop) -> void {
+	    ScratchArena arena;
+	    const ScopedScratch scratch(arena);
+	    while (true) {
+		Job job;
+		{
+		    std::unique_lock<std::mutex> lock(mutex);
+		    if (!ready.wait(lock, stop, [&]() -> bool { return !jobs_pending.empty(); })) {
+			return;
+		    }
+		    job = std::move(jobs_pending.front());
+		    jobs_pending.pop();
+		}
+		std::string reply = run_job(solvers, job);
+		arena.rewind();
+		{
+		    const std::scoped_lock<std::mutex> lock(mutex);
+		    completed.push_back({job.client, std::move(reply)});
+		}
+		const char byte = 0;
+		(void)::write(wake[1], &byte, 1);
+	    }
+	});
+    }
+
+    // Only the event loop touches the connections: it reads requests,
+    // hands them to the workers and writes their replies back, so an idle
+    // connection holds no worker
+    std::map<uint64_t, Client> clients;
+    uint64_t next_id = 0;
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> polled;
+    std::vector<char> chunk(READ_CHUNK);
+    std::cerr << "Listening on " << socket_path << " with " << jobs << " workers" << '\n';
+    while (true) {
+	fds.assign({{listener, POLLIN, 0}, {wake[0], POLLIN, 0}});
+	polled.clear();
+	for (const auto& [id, client] : clients) {
+	    if (client.busy) {
+		continue;
+	    }
+	    const short events = client.out.empty() ? POLLIN : POLLOUT;
+	    fds.push_back({client.sock, events, 0});
+	    polled.push_back(id);
+	}
+	if (::poll(fds.data(), fds.size(), -1) < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    throw sys_error("poll");
+	}
+
+	if ((fds[0].revents & POLLIN) != 0) {
+	    int sock = -1;
+	    while ((sock = ::accept(listener, nullptr, nullptr)) >= 0) {
+		set_nonblocking(sock);
+		clients.try_emplace(next_id++, sock);
+	    }
+	    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED) {
+		throw sys_error("accept");
+	    }
+	}
+	if ((fds[1].revents & POLLIN) != 0) {
+	    while (::read(wake[0], chunk.data(), chunk.size()) > 0) {
+	    }
+	    std::vector<Completion> done;
+	    {
+		const std::scoped_lock<std::mutex> lock(mutex);
+		done.swap(completed);
+	    }
+	    for (Completion& completion : done) {
+		Client& client = clients.at(completion.client);
+		client.out += completion.reply;
+		client.busy = false;
+	    }
+	}
+
+	std::vector<uint64_t> gone;
+	for (size_t i = 0; i < polled.size(); i++) {
+	    Client& client = clients.at(polled[i]);
+	    const short revents = fds[i + 2].revents;
+	    if (revents == 0) {
+		continue;
+	    }
+	    const bool alive = (fds[i + 2].events & POLLIN) != 0 ? read_some(client, chunk) : write_some(client);
+	    if (!alive) {
+		gone.push_back(polled[i]);
+	    }
+	}
+	for (const uint64_t id : gone) {
+	    ::close(clients.at(id).sock);
+	    clients.erase(id);
+	}
+
+	// What can be written without waiting, then the next request of
+	// every idle connection; connections with nothing left to do are
+	// closed
+	for (auto iter = clients.begin(); iter != clients.end();) {
+	    auto& [id, client] = *iter;
+	    bool alive = write_some(client);
+	    if (alive && !client.busy && client.out.empty()) {
+		std::optional<Job> job = next_job(client, id);
+		if (job) {
+		    client.busy = true;
+		    {
+			const std::scoped_lock<std::mutex> lock(mutex);
+			jobs_pending.push(std::move(*job));
+		    }
+		    ready.notify_one();
+		}
+		alive = write_some(client);
+	    }
+	    const bool finished = !client.busy && client.out.empty() && client.eof;
+	    if (finished && (!client.in.empty() || client.header)) {
+		std::cerr << "Connection dropped: Truncated request" << '\n';
+	    }
+	    if (!alive || finished) {
+		::close(client.sock);
+		iter = clients.erase(iter);
+	    } else {
+		++iter;
+	    }
+	}
+    }
+}
+
+auto run_client(const std::string& socket_path, int day, int part, const std::string& path) -> int
+{
+    (void)std::signal(SIGPIPE, SIG_IGN); // NOLINT(cert-err33-c)
+    Connection conn(connect_to(socket_path));
+
+    std::string request = std::to_string(day) + " " + std::to_string(part);
+    if (path == "-") {
+	const std::string input{std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()};
+	request += " bytes " + std::to_string(input.size()) + "\n" + input;
+    } else {
+	request += " path " + std::filesystem::absolute(path).string() + "\n";
+    }
+    conn.write_all(request);
+
+    std::string reply;
+    if (!conn.read_line(reply)) {
+	throw std::runtime_error("No reply from " + socket_path);
+    }
+    if (reply.starts_with("OK ")) {
+	std::cout << reply.substr(3) << '\n';
+	return EXIT_SUCCESS;
+    }
+    std::cerr << reply << '\n';
+    return EXIT_FAILURE;
+}
+
+// Every connection sends its share of the requests back to back, with the
+// input inline, and records the round-trip time of each one. Requests
+// left when a connection fails are counted as failed.
+auto run_load_test(const std::string& socket_path, int day, int part, const std::string& path,
+		   size_t n_requests, size_t n_connections) -> int
+{
+    (void)std::signal(SIGPIPE, SIG_IGN); // NOLINT(cert-err33-c)
+    CHECK(n_connections > 0);
+    const std::string input = read_file(path);
+    const std::string request = std::to_string(day) + " " + std::to_string(part)
+	+ " bytes " + std::to_string(input.size()) + "\n" + input;
+
+    std::vector<std::vector<double>> latencies(n_connections);
+    std::vector<size_t> failures(n_connections, 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+	std::vector<std::jthread> clients;
+	clients.reserve(n_connections);
+	for (size_t conn_id = 0; conn_id < n_connections; conn_id++) {
+	    const size_t share = (n_requests / n_connections) + (conn_id < n_requests % n_connections ? 1 : 0);
+	    clients.emplace_back([&, conn_id, share]() -> void {
+		size_t done = 0;
+		try {
+		    Connection conn(connect_to(socket_path));
+		    std::string reply;
+		    latencies[conn_id].reserve(share);
+		    for (; done < share; done++) {
+			const auto sent = std::chrono::steady_clock::now();
+			conn.write_all(request);
+			if (!conn.read_line(reply)) {
+			    break;
+			}
+			const std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - sent;
+			latencies[conn_id].push_back(latency.count());
+			failures[conn_id] += reply.starts_with("OK ") ? 0 : 1;
+		    }
+		} catch (const std::exception& e) {
+		    std::cerr << e.what() << '\n';
+		}
+		failures[conn_id] += share - done;
+	    });
+	}
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<double> all;
+    for (const std::vector<double>& lat : latencies) {
+	all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::ranges::sort(all);
+    const size_t n_failed = std::accumulate(failures.begin(), failures.end(), size_t{0});
+
+    std::cout << "Day " << day << ", Part " << part << " // " << all.size() << " requests over "
+	      << n_connections << " connections in " << elapsed.count() << " s: "
+	      << static_cast<double>(all.size()) / elapsed.count() << " requests/s, "
+	      << n_failed << " failed" << '\n';
+    if (!all.empty()) {
+	const double mean = std::accumulate(all.begin(), all.end(), 0.0) / static_cast<double>(all.size());
+	std::cout << "Latency (us) // min " << all.front()
+		  << ", mean " << mean
+		  << ", p50 " << percentile(all, 0.5) // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << ", p90 " << percentile(all, 0.9) // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << ", p99 " << percentile(all, 0.99) // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << ", p99.9 " << percentile(all, 0.999) // NOLINT(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+		  << ", max " << all.back() << '\n';
+    }
+
+    return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "batch.hpp"
+
+// Part 1 and part 2 solvers of every implemented day
+using SolverTable = std::map<int, std::pair<Solver, Solver>>;
+
+// Protocol, one request after the other on a connection:
+//   "<day> <part> path <path>\n"        input read by the server
+//   "<day> <part> bytes <n>\n<n bytes>"  input sent inline, at most 256 MiB
+// Each request is answered by "OK <answer>\n" or "ERR <message>\n", in
+// order. Request lines are at most 64 KiB. One thread reads and writes
+// every connection and hands each request to the next free worker, so
+// idle connections hold no worker.
+int run_server(const std::string& socket_path, const SolverTable& solvers, size_t jobs);
+
+// Send one request; path "-" sends standard input inline
+int run_client(const std::string& socket_path, int day, int part, const std::string& path);
+
+int run_load_test(const std::string& socket_path, int day, int part, const std::string& path,
+		  size_t n_requests, size_t n_connections);
@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "simd.hpp"
+
+namespace {
+
+struct Kernels {
+    uint64_t (*match_mask)(const char *, char);
+    std::optional<uint64_t> (*parse_digits)(std::string_view);
+    void (*count_neighbours)(std::string_view, std::string_view, std::string_view, char, std::span<uint8_t>);
+    size_t (*count_in_ranges)(std::span<const size_t>, std::span<const size_t>, std::span<const size_t>);
+};
+
+constexpr size_t MAX_DIGITS = 19; // Largest run that always fits in 64 bits
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+// Scalar variants, also used for the edges and tails of the vector ones
+
+auto match_mask_scalar(const char *block, char byte) -> uint64_t
+{
+    uint64_t mask = 0;
+    for (size_t k = 0; k < SCAN_BLOCK; k++) {
+	mask |= static_cast<uint64_t>(block[k] == byte) << k;
+    }
+    return mask;
+}
+
+auto parse_digits_scalar(std::string_view digits) -> std::optional<uint64_t>
+{
+    if (digits.empty() || digits.size() > MAX_DIGITS) {
+	return {};
+    }
+    uint64_t value = 0;
+    for (const char chr : digits) {
+	if (chr < '0' || chr > '9') {
+	    return {};
+	}
+	value = (value * 10) + static_cast<uint64_t>(chr - '0');
+    }
+    return value;
+}
+
+auto neighbours_at(std::string_view above, std::string_view row, std::string_view below, char symbol, size_t j)
+    -> uint8_t
+{
+    uint8_t count = 0;
+    for (size_t k = j == 0 ? 0 : j - 1; k < std::min(j + 2, row.size()); k++) {
+	count += static_cast<uint8_t>(!above.empty() && above[k] == symbol);
+	count += static_cast<uint8_t>(!below.empty() && below[k] == symbol);
+	count += static_cast<uint8_t>(k != j && row[k] == symbol);
+    }
+    return count;
+}
+
+auto count_neighbours_scalar(std::string_view above, std::string_view row, std::string_view below, char symbol,
+			     std::span<uint8_t> counts) -> void
+{
+    for (size_t j = 0; j < row.size(); j++) {
+	counts[j] = neighbours_at(above, row, below, symbol, j);
+    }
+}
+
+auto in_ranges(std::span<const size_t> starts, std::span<const size_t> ends, size_t iid) -> bool
+{
+    const auto next = std::ranges::upper_bound(starts, iid);
+    return next != starts.begin() && iid <= ends[static_cast<size_t>(next - starts.begin()) - 1];
+}
+
+auto count_in_ranges_scalar(std::span<const size_t> starts, std::span<const size_t> ends,
+			    std::span<const size_t> ids) -> size_t
+{
+    return static_cast<size_t>(std::ranges::count_if(ids, [&](size_t iid) -> bool { return in_ranges(starts, ends, iid); }));
+}
+
+#if defined(__x86_64__)
+
+// The vector variants share their code through these templates, written
+// with the GCC vector extensions and instantiated at the width of each
+// instruction set. Being inlined into functions with a target attribute,
+// they are compiled for that target only; flatten does the inlining where
+// a template calls a helper with a target of its own.
+using Bytes16 = int8_t __attribute__((vector_size(16)));
+using Bytes32 = int8_t __attribute__((vector_size(32)));
+using Bytes64 = int8_t __attribute__((vector_size(64)));
+using Words2 = size_t __attribute__((vector_size(16)));
+using Words4 = size_t __attribute__((vector_size(32)));
+
+// Out parameters rather than return values: functions without a target
+// attribute cannot pass wide vectors in registers
+template <typename V>
+[[gnu::always_inline]] inline auto load(V& value, const void *ptr) -> void
+{
+    std::memcpy(&value, ptr, sizeof(V));
+}
+
+// Adds -1 to every lane whose byte of line, from j on, is symbol
+template <typename V>
+[[gnu::always_inline]] inline auto add_matches(V& total, std::string_view line, size_t j, const V& sym) -> void
+{
+    if (!line.empty()) {
+	V bytes;
+	load(bytes, line.data() + j);
+	total += bytes == sym;
+    }
+}
+
+// Counts of the sizeof(V) cells of row from j on, which must have cells
+// on both sides
+template <typename V>
+[[gnu::always_inline]] inline auto neighbours_block(std::string_view above, std::string_view row,
+						    std::string_view below, const V& sym, std::span<uint8_t> counts,
+						    size_t j) -> void
+{
+    V total{};
+    add_matches(total, row, j - 1, sym);
+    add_matches(total, row, j + 1, sym);
+    for (const std::string_view line : {above, below}) {
+	add_matches(total, line, j - 1, sym);
+	add_matches(total, line, j, sym);
+	add_matches(total, line, j + 1, sym);
+    }
+    total = -total;
+    std::memcpy(&counts[j], &total, sizeof(V));
+}
+
+// The middle of the row is done sizeof(V) cells at a time, each count a
+// sum of -1 comparison results, the last block overlapping the one before
+// it. The first and last cells, whose neighbours would be read past the
+// row, are done one by one, as are rows too short for a block.
+template <typename V>
+[[gnu::always_inline]] inline auto count_neighbours_vec(std::string_view above, std::string_view row,
+							std::string_view below, char symbol,
+							std::span<uint8_t> counts) -> void
+{
+    const size_t n = row.size();
+    if (n < sizeof(V) + 2) {
+	count_neighbours_scalar(above, row, below, symbol, counts);
+	return;
+    }
+
+    const V sym = V{} + static_cast<int8_t>(symbol);
+    for (size_t j = 1; j + sizeof(V) < n; j += sizeof(V)) {
+	neighbours_block(above, row, below, sym, counts, j);
+    }
+    neighbours_block(above, row, below, sym, counts, n - 1 - sizeof(V));
+    counts[0] = neighbours_at(above, row, below, symbol, 0);
+    counts[n - 1] = neighbours_at(above, row, below, symbol, n - 1);
+}
+
+// values[k] = base[idx[k]], with a gather instruction where there is one
+template <typename V>
+[[gnu::always_inline]] inline auto gather(V& values, const size_t *base, const V& idx) -> void
+{
+    for (size_t k = 0; k < sizeof(V) / sizeof(size_t); k++) {
+	values[k] = base[idx[k]];
+    }
+}
+
+[[gnu::target("avx2")]] inline auto gather(Words4& values, const size_t *base, const Words4& idx) -> void
+{
+    __m256i lanes; // NOLINT(cppcoreguidelines-init-variables)
+    std::memcpy(&lanes, &idx, sizeof(lanes));
+    lanes = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(base), lanes, sizeof(size_t)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,google-runtime-int)
+    std::memcpy(&values, &lanes, sizeof(lanes));
+}
+
+// Branch-free search of a vector of ids in lockstep: every lane takes the
+// same power-of-two steps over the starts, so that no lane waits on a
+// mispredicted branch and the loads of all lanes are in flight together.
+template <typename V>
+inline auto count_in_ranges_vec(std::span<const size_t> starts, std::span<const size_t> ends,
+				std::span<const size_t> ids) -> size_t
+{
+    constexpr size_t LANES = sizeof(V) / sizeof(size_t);
+    const size_t n = starts.size();
+    if (n == 0) {
+	return 0;
+    }
+
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + LANES <= ids.size(); i += LANES) {
+	V iid;
+	load(iid, &ids[i]);
+	V pos{}; // Starts not after the id
+	for (size_t step = std::bit_floor(n); step > 0; step >>= 1) {
+	    // Steps past the end read the last start and are not taken
+	    const V next = pos + step;
+	    const auto past = next > n; // Signed lanes
+	    V past_bits;
+	    load(past_bits, &past);
+	    V start;
+	    gather(start, starts.data(), next - (past_bits & (next - n)) - 1);
+	    const auto taken = ~past & (start <= iid);
+	    V step_taken;
+	    load(step_taken, &taken);
+	    pos += step_taken & step;
+	}
+	for (size_t k = 0; k < LANES; k++) {
+	    count += static_cast<size_t>(pos[k] > 0 && iid[k] <= ends[pos[k] - 1]);
+	}
+    }
+    return count + count_in_ranges_scalar(starts, ends, ids.subspan(i));
+}
+
+// 16 digits at once: the digits are aligned to the right of a block of
+// zeros, built from two 8-byte words without a variable-length copy, then
+// combined in pairs, fours and eights by multiply-adds
+[[gnu::target("sse4.2"), gnu::always_inline]] inline auto parse_digits_128(std::string_view digits)
+    -> std::optional<uint64_t>
+{
+    constexpr size_t WORD = 8;
+    constexpr uint64_t ZEROS = 0x3030303030303030; // Eight '0'
+    const size_t n = digits.size();
+    if (n > 2 * WORD) {
+	return parse_digits_scalar(digits);
+    }
+    if (n == 0) {
+	return {};
+    }
+
+    // high holds digits 0 to 7 of the block, low digits 8 to 15
+    uint64_t high = ZEROS;
+    uint64_t low = ZEROS;
+    if (n >= WORD) {
+	std::memcpy(&low, digits.data() + n - WORD, WORD);
+	if (n > WORD) {
+	    std::memcpy(&high, digits.data(), WORD);
+	    if (n < 2 * WORD) {
+		high = (high << (CHAR_BIT * (2 * WORD - n))) | (ZEROS >> (CHAR_BIT * (n - WORD)));
+	    }
+	}
+    } else {
+	for (const char chr : digits) {
+	    low = (low >> CHAR_BIT) | (static_cast<uint64_t>(static_cast<uint8_t>(chr)) << (CHAR_BIT * (WORD - 1)));
+	}
+    }
+    const __m128i values = _mm_sub_epi8(_mm_set_epi64x(static_cast<int64_t>(low), static_cast<int64_t>(high)), _mm_set1_epi8('0'));
+    const __m128i nine = _mm_set1_epi8(9);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(values, nine), nine)) != 0xFFFF) {
+	return {};
+    }
+
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    const __m128i fours = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    const __m128i packed = _mm_packus_epi32(fours, fours);
+    const __m128i eights = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    return (static_cast<uint64_t>(_mm_cvtsi128_si32(eights)) * 100000000)
+	+ static_cast<uint64_t>(_mm_extract_epi32(eights, 1));
+}
+
+[[gnu::target("sse4.2")]] auto match_mask_sse42(const char *block, char byte) -> uint64_t
+{
+    const __m128i pattern = _mm_set1_epi8(byte);
+    uint64_t mask = 0;
+    for (size_t k = 0; k < SCAN_BLOCK; k += 16) {
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + k)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern)))) << k;
+    }
+    return mask;
+}
+
+[[gnu::target("sse4.2")]] auto parse_digits_sse42(std::string_view digits) -> std::optional<uint64_t>
+{
+    return parse_digits_128(digits);
+}
+
+[[gnu::target("sse4.2")]] auto count_neighbours_sse42(std::string_view above, std::string_view row,
+						      std::string_view below, char symbol, std::span<uint8_t> counts) -> void
+{
+    count_neighbours_vec<Bytes16>(above, row, below, symbol, counts);
+}
+
+[[gnu::target("sse4.2"), gnu::flatten]] auto count_in_ranges_sse42(std::span<const size_t> starts,
+								    std::span<const size_t> ends,
+								    std::span<const size_t> ids) -> size_t
+{
+    return count_in_ranges_vec<Words2>(starts, ends, ids);
+}
+
+[[gnu::target("avx2")]] auto match_mask_avx2(const char *block, char byte) -> uint64_t
+{
+    const __m256i pattern = _mm256_set1_epi8(byte);
+    uint64_t mask = 0;
+    for (size_t k = 0; k < SCAN_BLOCK; k += 32) {
+	const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + k)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, pattern)))) << k;
+    }
+    return mask;
+}
+
+// A single integer gains nothing from wider registers: the 128-bit
+// multiply-adds are kept, in their VEX encoding
+[[gnu::target("avx2")]] auto parse_digits_avx2(std::string_view digits) -> std::optional<uint64_t>
+{
+    return parse_digits_128(digits);
+}
+
+[[gnu::target("avx2")]] auto count_neighbours_avx2(std::string_view above, std::string_view row,
+						   std::string_view below, char symbol, std::span<uint8_t> counts) -> void
+{
+    count_neighbours_vec<Bytes32>(above, row, below, symbol, counts);
+}
+
+[[gnu::target("avx2"), gnu::flatten]] auto count_in_ranges_avx2(std::span<const size_t> starts,
+								  std::span<const size_t> ends,
+								  std::span<const size_t> ids) -> size_t
+{
+    return count_in_ranges_vec<Words4>(starts, ends, ids);
+}
+
+[[gnu::target("avx512f,avx512bw")]] auto match_mask_avx512(const char *block, char byte) -> uint64_t
+{
+    return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(block), _mm512_set1_epi8(byte));
+}
+
+[[gnu::target("avx512f,avx512bw")]] auto parse_digits_avx512(std::string_view digits) -> std::optional<uint64_t>
+{
+    return parse_digits_128(digits);
+}
+
+[[gnu::target("avx512f,avx512bw")]] auto count_neighbours_avx512(std::string_view above, std::string_view row,
+								 std::string_view below, char symbol,
+								 std::span<uint8_t> counts) -> void
+{
+    count_neighbours_vec<Bytes64>(above, row, below, symbol, counts);
+}
+
+#endif
+
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+// Indexed by Isa
+constexpr std::array KERNELS = {
+    Kernels{match_mask_scalar, parse_digits_scalar, count_neighbours_scalar, count_in_ranges_scalar},
+#if defined(__x86_64__)
+    Kernels{match_mask_sse42, parse_digits_sse42, count_neighbours_sse42, count_in_ranges_sse42},
+    Kernels{match_mask_avx2, parse_digits_avx2, count_neighbours_avx2, count_in_ranges_avx2},
+    // Eight-lane gathers were measured slower than four-lane ones
+    Kernels{match_mask_avx512, parse_digits_avx512, count_neighbours_avx512, count_in_ranges_avx2},
+#endif
+};
+
+// Every level implies the ones below it on the CPUs that have it
+auto best_isa() -> Isa
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+	return Isa::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+	return Isa::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+	return Isa::Sse42;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+// Chosen on first use, which may come before main from static
+// initializers of other files
+auto active() -> std::atomic<Isa>&
+{
+    static std::atomic<Isa> chosen{best_isa()};
+    return chosen;
+}
+
+auto kernels() -> const Kernels&
+{
+    return KERNELS.at(static_cast<size_t>(active().load(std::memory_order_relaxed)));
+}
+
+} // namespace
+
+auto isa_name(Isa isa) -> std::string_view
+{
+    switch (isa) {
+    case Isa::Scalar:
+	return "scalar";
+    case Isa::Sse42:
+	return "sse4.2";
+    case Isa::Avx2:
+	return "avx2";
+    case Isa::Avx512:
+	return "avx512";
+    }
+    return "unknown";
+}
+
+auto isa_from_name(std::string_view name) -> std::optional<Isa>
+{
+    const auto found = std::ranges::find(ISAS, name, isa_name);
+    if (found == ISAS.end()) {
+	return {};
+    }
+    return *found;
+}
+
+auto isa_supported(Isa isa) -> bool
+{
+    static const Isa best = best_isa();
+    return static_cast<uint8_t>(isa) <= static_cast<uint8_t>(best);
+}
+
+auto isa() -> Isa
+{
+    return active();
+}
+
+auto set_isa(Isa isa) -> void
+{
+    if (!isa_supported(isa)) {
+	throw std::runtime_error("This CPU does not support " + std::string(isa_name(isa)));
+    }
+    active() = isa;
+}
+
+ScopedIsa::ScopedIsa(Isa isa)
+    : m_previous{active()}
+{
+    set_isa(isa);
+}
+
+ScopedIsa::~ScopedIsa()
+{
+    active() = m_previous;
+}
+
+auto match_mask(const char *block, char byte) -> uint64_t
+{
+    return kernels().match_mask(block, byte);
+}
+
+auto parse_digits(std::string_view digits) -> std::optional<uint64_t>
+{
+    return kernels().parse_digits(digits);
+}
+
+auto count_neighbours(std::string_view above, std::string_view row, std::string_view below, char symbol,
+		      std::span<uint8_t> counts) -> void
+{
+    kernels().count_neighbours(above, row, below, symbol, counts);
+}
+
+auto count_in_ranges(std::span<const size_t> starts, std::span<const size_t> ends,
+		     std::span<const size_t> ids) -> size_t
+{
+    return kernels().count_in_ranges(starts, ends, ids);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+// Hot kernels with a variant per instruction set. The binary targets the
+// baseline ISA; the best variant the CPU supports is chosen once, on
+// first use, and set_isa forces another one so that every variant can be
+// checked on one machine. Outside x86-64 only the scalar variants exist.
+enum class Isa : uint8_t { Scalar, Sse42, Avx2, Avx512 };
+
+inline constexpr std::array ISAS = {Isa::Scalar, Isa::Sse42, Isa::Avx2, Isa::Avx512};
+
+std::string_view isa_name(Isa isa);
+std::optional<Isa> isa_from_name(std::string_view name);
+bool isa_supported(Isa isa);
+
+// Variant in use; set_isa throws if the CPU lacks the requested one
+Isa isa();
+void set_isa(Isa isa);
+
+// Forces a variant for its lifetime, then puts back the one in use
+// before it, even when an exception leaves the scope
+class ScopedIsa {
+public:
+    explicit ScopedIsa(Isa isa);
+    ~ScopedIsa();
+    ScopedIsa(const ScopedIsa&) = delete;
+    ScopedIsa(ScopedIsa&&) = delete;
+    ScopedIsa& operator=(const ScopedIsa&) = delete;
+    ScopedIsa& operator=(ScopedIsa&&) = delete;
+
+private:
+    Isa m_previous;
+};
+
+// Bytes scanned by one match_mask call
+constexpr size_t SCAN_BLOCK = 64;
+
+// Bit k set when block[k] is byte, over SCAN_BLOCK bytes
+uint64_t match_mask(const char *block, char byte);
+
+// Value of a run of at most 19 decimal digits, nullopt on anything else
+std::optional<uint64_t> parse_digits(std::string_view digits);
+
+// counts[j]: cells of row equal to symbol among the eight neighbours of
+// row[j]. above and below are the rows around it, empty at the edges.
+void count_neighbours(std::string_view above, std::string_view row, std::string_view below, char symbol,
+		      std::span<uint8_t> counts);
+
+// Ids held by one of the sorted, disjoint ranges [starts[k], ends[k]]
+size_t count_in_ranges(std::span<const size_t> starts, std::span<const size_t> ends, std::span<const size_t> ids);